@@ -1,8 +1,13 @@
 #include "gamestate.h"
 #include "search.h"
+#include "search_chance.h"
+#include "pimc.h"
 #include "eval_nnue.h"
+#include "eval_cache.h"
+#include "nnue_quant.h"
 #include "rand.h"
 #include "mcts.h"
+#include "tablebase.h"
 
 #include <algorithm>
 #include <chrono>
@@ -12,6 +17,7 @@
 #include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -31,6 +37,8 @@ uint64_t randomSeed64() {
 
 enum class EngineType {
     AlphaBeta,
+    Chance, // alpha-beta com nós de acaso nas compras
+    PIMC,   // alpha-beta sobre K determinizações
     MCTS
 };
 
@@ -41,8 +49,11 @@ struct EngineSpec {
     // Alpha-beta parameters
     int depth = 4;
     std::string nnuePath = "nnue_iter0.bin";
+    std::string qnnuePath; // rede quantizada (opcional)
     NNUEWeights weights;
     bool weightsLoaded = false;
+    ChanceSearchConfig chanceCfg;
+    PIMCConfig pimcCfg;
 
     // MCTS parameters
     MCTSConfig mctsCfg;
@@ -56,6 +67,9 @@ struct MatchConfig {
     int games = 100;
     bool perfectInfo = false;
     uint64_t seed = randomSeed64();
+    int hashMB = (int)TranspositionTable::DEFAULT_MB;
+    int evalCacheMB = (int)NNUEEvalCache::DEFAULT_MB;
+    std::string tbPath;
 };
 
 bool iequals(const std::string& a, const std::string& b) {
@@ -70,6 +84,8 @@ bool iequals(const std::string& a, const std::string& b) {
 
 EngineType parseEngineType(const std::string& s) {
     if (iequals(s, "ab") || iequals(s, "alphabeta")) return EngineType::AlphaBeta;
+    if (iequals(s, "chance")) return EngineType::Chance;
+    if (iequals(s, "pimc")) return EngineType::PIMC;
     if (iequals(s, "mcts")) return EngineType::MCTS;
     throw std::runtime_error("Engine type desconhecido: " + s);
 }
@@ -88,7 +104,7 @@ void ensureWeightsLoaded(EngineSpec& spec) {
 
     if (!loadWeights(spec.weights, spec.nnuePath)) {
         std::cerr << "Aviso: não consegui carregar NNUE '" << spec.nnuePath << "'.";
-        if (spec.type == EngineType::AlphaBeta) {
+        if (spec.type != EngineType::MCTS) {
             std::cerr << " Inicializando pesos aleatórios.\n";
             spec.weights.inputSize = 178;
             spec.weights.hidden1 = 64;
@@ -105,6 +121,15 @@ void ensureWeightsLoaded(EngineSpec& spec) {
         return;
     }
 
+    if (!spec.qnnuePath.empty()) {
+        auto q = std::make_shared<QuantizedNNUE>();
+        if (loadQuantized(*q, spec.qnnuePath))
+            spec.weights.quant = q;
+        else
+            std::cerr << "Aviso: não consegui carregar NNUE quantizada '" << spec.qnnuePath
+                      << "'. A usar a rede float.\n";
+    }
+
     spec.weightsLoaded = true;
     if (spec.type == EngineType::MCTS) {
         spec.mctsCfg.weights = &spec.weights;
@@ -123,6 +148,20 @@ int chooseMove(const EngineSpec& spec,
         return res.chosenMoveIndex;
     }
 
+    if (spec.type == EngineType::Chance) {
+        SearchResult res = searchBestMoveChance(state, spec.weights, spec.depth, perfectInfo,
+                                                spec.chanceCfg);
+        return res.chosenMoveIndex;
+    }
+
+    if (spec.type == EngineType::PIMC) {
+        PIMCConfig cfg = spec.pimcCfg;
+        cfg.depth = spec.depth;
+        cfg.seed = rngForSearch.nextU64();
+        SearchResult res = searchBestMovePIMC(state, spec.weights, perfectInfo, cfg);
+        return res.chosenMoveIndex;
+    }
+
     if (spec.type == EngineType::MCTS) {
         MCTSResult res = searchBestMoveMCTS(state, player, rngForSearch, spec.mctsCfg);
         return res.chosenMoveIndex;
@@ -140,9 +179,19 @@ std::string engineDescription(const EngineSpec& spec) {
 
     if (spec.type == EngineType::AlphaBeta) {
         oss << "AlphaBeta(depth=" << spec.depth << ", nnue=" << spec.nnuePath << ")";
+    } else if (spec.type == EngineType::Chance) {
+        oss << "Chance(depth=" << spec.depth << ", width=" << spec.chanceCfg.maxOutcomes
+            << ", nnue=" << spec.nnuePath << ")";
+    } else if (spec.type == EngineType::PIMC) {
+        oss << "PIMC(depth=" << spec.depth << ", samples=" << spec.pimcCfg.samples
+            << ", nnue=" << spec.nnuePath << ")";
     } else {
-        oss << "MCTS(iter=" << spec.mctsCfg.iterations
+        oss << (spec.mctsCfg.informationSet ? "ISMCTS(iter=" : "MCTS(iter=") << spec.mctsCfg.iterations
             << ", cpuct=" << std::fixed << std::setprecision(2) << spec.mctsCfg.exploration;
+        if (spec.mctsCfg.rootTrees > 1) oss << ", trees=" << spec.mctsCfg.rootTrees;
+        if (spec.mctsCfg.valueNet) oss << ", valuenet";
+        if (spec.mctsCfg.rolloutLimit > 0) oss << ", rollout=" << spec.mctsCfg.rolloutLimit;
+        if (spec.mctsCfg.leafBatch > 1) oss << ", batch=" << spec.mctsCfg.leafBatch;
         if (spec.mctsCfg.useNNUE && spec.mctsCfg.weights) {
             oss << ", nnue=" << spec.nnuePath;
         }
@@ -153,19 +202,38 @@ std::string engineDescription(const EngineSpec& spec) {
 
 void printUsage() {
     std::cout << "Uso: bisca4_match [opções]\n"
-              << "  --engine1 ab|mcts           Tipo do jogador 1 (default ab)\n"
-              << "  --engine2 ab|mcts           Tipo do jogador 2 (default ab)\n"
-              << "  --nnue1 caminho.bin         NNUE para engine1 (ab)\n"
-              << "  --nnue2 caminho.bin         NNUE para engine2 (ab)\n"
-              << "  --depth1 N                  Profundidade para engine1 (ab)\n"
-              << "  --depth2 N                  Profundidade para engine2 (ab)\n"
+              << "  --engine1 ab|chance|pimc|mcts  Tipo do jogador 1 (default ab)\n"
+              << "  --engine2 ab|chance|pimc|mcts  Tipo do jogador 2 (default ab)\n"
+              << "  --nnue1 caminho.bin         NNUE para engine1 (ab/chance/pimc)\n"
+              << "  --nnue2 caminho.bin         NNUE para engine2 (ab/chance/pimc)\n"
+              << "  --qnnue1 caminho.bin        NNUE quantizada para engine1 (ver bisca4 --mode quantize)\n"
+              << "  --qnnue2 caminho.bin        NNUE quantizada para engine2\n"
+              << "  --depth1 N                  Profundidade para engine1 (ab/chance/pimc por amostra)\n"
+              << "  --depth2 N                  Profundidade para engine2 (ab/chance/pimc por amostra)\n"
+              << "  --chance-width1 N           Máx. compras por nó de acaso jogador1 (chance)\n"
+              << "  --chance-width2 N           Máx. compras por nó de acaso jogador2 (chance)\n"
+              << "  --pimc-samples1 N           Determinizações por lance jogador1 (pimc)\n"
+              << "  --pimc-samples2 N           Determinizações por lance jogador2 (pimc)\n"
+              << "  --pimc-threads1 N           Threads PIMC jogador1 (0 = auto)\n"
+              << "  --pimc-threads2 N           Threads PIMC jogador2 (0 = auto)\n"
+              << "  --ismcts1 / --ismcts2       Usa SO-ISMCTS (árvore por conjunto de informação)\n"
               << "  --iterations1 N             Iterações MCTS jogador1\n"
               << "  --iterations2 N             Iterações MCTS jogador2\n"
               << "  --cpuct1 X                  C constante MCTS jogador1\n"
               << "  --cpuct2 X                  C constante MCTS jogador2\n"
+              << "  --root-trees1 N             Árvores MCTS independentes (root-parallel) jogador1\n"
+              << "  --root-trees2 N             Árvores MCTS independentes (root-parallel) jogador2\n"
+              << "  --value-net1 / --value-net2 Folhas MCTS avaliadas pela NNUE, sem rollouts\n"
+              << "  --rollout-limit1 N          Jogadas aleatórias antes da NNUE nas folhas MCTS jogador1\n"
+              << "  --rollout-limit2 N          Jogadas aleatórias antes da NNUE nas folhas MCTS jogador2\n"
+              << "  --leaf-batch1 N             Folhas MCTS por lote da NNUE jogador1\n"
+              << "  --leaf-batch2 N             Folhas MCTS por lote da NNUE jogador2\n"
               << "  --games N                   Número de partidas (default 100)\n"
               << "  --perfect-info              Ativa modo perfect info para ambos\n"
               << "  --seed N                    Seed base (uint64)\n"
+              << "  --hash MB                   Tamanho da TT alpha-beta (default 64)\n"
+              << "  --evalcache MB              Cache de avaliações NNUE (default 8, 0 = desligada)\n"
+              << "  --tb caminho.tb             Tablebase de fim de jogo (ver bisca4 --mode gentb)\n"
               << "Exemplos:\n"
               << "  bisca4_match --engine1 ab --engine2 mcts --depth1 6 --iterations2 4000 --games 200\n";
 }
@@ -189,10 +257,30 @@ MatchConfig parseArgs(int argc, char** argv) {
             cfg.engine[0].nnuePath = requireValue(arg);
         } else if (arg == "--nnue2") {
             cfg.engine[1].nnuePath = requireValue(arg);
+        } else if (arg == "--qnnue1") {
+            cfg.engine[0].qnnuePath = requireValue(arg);
+        } else if (arg == "--qnnue2") {
+            cfg.engine[1].qnnuePath = requireValue(arg);
         } else if (arg == "--depth1") {
             cfg.engine[0].depth = std::max(1, std::atoi(requireValue(arg)));
         } else if (arg == "--depth2") {
             cfg.engine[1].depth = std::max(1, std::atoi(requireValue(arg)));
+        } else if (arg == "--chance-width1") {
+            cfg.engine[0].chanceCfg.maxOutcomes = std::max(1, std::atoi(requireValue(arg)));
+        } else if (arg == "--chance-width2") {
+            cfg.engine[1].chanceCfg.maxOutcomes = std::max(1, std::atoi(requireValue(arg)));
+        } else if (arg == "--pimc-samples1") {
+            cfg.engine[0].pimcCfg.samples = std::max(1, std::atoi(requireValue(arg)));
+        } else if (arg == "--pimc-samples2") {
+            cfg.engine[1].pimcCfg.samples = std::max(1, std::atoi(requireValue(arg)));
+        } else if (arg == "--pimc-threads1") {
+            cfg.engine[0].pimcCfg.threads = std::max(0, std::atoi(requireValue(arg)));
+        } else if (arg == "--pimc-threads2") {
+            cfg.engine[1].pimcCfg.threads = std::max(0, std::atoi(requireValue(arg)));
+        } else if (arg == "--ismcts1") {
+            cfg.engine[0].mctsCfg.informationSet = true;
+        } else if (arg == "--ismcts2") {
+            cfg.engine[1].mctsCfg.informationSet = true;
         } else if (arg == "--iterations1") {
             cfg.engine[0].mctsCfg.iterations = std::max(1, std::atoi(requireValue(arg)));
         } else if (arg == "--iterations2") {
@@ -201,12 +289,34 @@ MatchConfig parseArgs(int argc, char** argv) {
             cfg.engine[0].mctsCfg.exploration = std::max(0.01f, static_cast<float>(std::atof(requireValue(arg))));
         } else if (arg == "--cpuct2") {
             cfg.engine[1].mctsCfg.exploration = std::max(0.01f, static_cast<float>(std::atof(requireValue(arg))));
+        } else if (arg == "--root-trees1") {
+            cfg.engine[0].mctsCfg.rootTrees = std::max(1, std::atoi(requireValue(arg)));
+        } else if (arg == "--root-trees2") {
+            cfg.engine[1].mctsCfg.rootTrees = std::max(1, std::atoi(requireValue(arg)));
+        } else if (arg == "--value-net1") {
+            cfg.engine[0].mctsCfg.valueNet = true;
+        } else if (arg == "--value-net2") {
+            cfg.engine[1].mctsCfg.valueNet = true;
+        } else if (arg == "--rollout-limit1") {
+            cfg.engine[0].mctsCfg.rolloutLimit = std::max(0, std::atoi(requireValue(arg)));
+        } else if (arg == "--rollout-limit2") {
+            cfg.engine[1].mctsCfg.rolloutLimit = std::max(0, std::atoi(requireValue(arg)));
+        } else if (arg == "--leaf-batch1") {
+            cfg.engine[0].mctsCfg.leafBatch = std::max(1, std::atoi(requireValue(arg)));
+        } else if (arg == "--leaf-batch2") {
+            cfg.engine[1].mctsCfg.leafBatch = std::max(1, std::atoi(requireValue(arg)));
         } else if (arg == "--games") {
             cfg.games = std::max(1, std::atoi(requireValue(arg)));
         } else if (arg == "--perfect-info") {
             cfg.perfectInfo = true;
         } else if (arg == "--seed") {
             cfg.seed = static_cast<uint64_t>(std::strtoull(requireValue(arg), nullptr, 10));
+        } else if (arg == "--hash") {
+            cfg.hashMB = std::max(1, std::atoi(requireValue(arg)));
+        } else if (arg == "--evalcache") {
+            cfg.evalCacheMB = std::max(0, std::atoi(requireValue(arg)));
+        } else if (arg == "--tb") {
+            cfg.tbPath = requireValue(arg);
         } else if (arg == "--name1") {
             cfg.engine[0].name = requireValue(arg);
         } else if (arg == "--name2") {
@@ -242,6 +352,12 @@ int main(int argc, char** argv) {
         std::cout << "Seed base: " << cfg.seed << "\n";
         std::cout << "===========================\n";
 
+        if (cfg.hashMB != (int)g_TT.sizeMB()) g_TT.resize((size_t)cfg.hashMB);
+        if (cfg.evalCacheMB != (int)g_evalCache.sizeMB()) g_evalCache.resize((size_t)cfg.evalCacheMB);
+        if (!cfg.tbPath.empty() && !loadTablebase(cfg.tbPath)) {
+            std::cerr << "Aviso: não consegui carregar a tablebase '" << cfg.tbPath << "'.\n";
+        }
+
         ensureWeightsLoaded(cfg.engine[0]);
         ensureWeightsLoaded(cfg.engine[1]);
 
@@ -324,6 +440,9 @@ int main(int argc, char** argv) {
         std::cout << " Empates: " << draws << "\n";
         std::cout << " Diferença média de pontos (Engine1): "
                   << (cfg.games > 0 ? (double)scoreDiffEngine0 / cfg.games : 0.0) << "\n";
+        if (g_evalCache.enabled())
+            std::cout << " Cache de avaliação: hits=" << g_evalCache.hits() << "/" << g_evalCache.probes()
+                      << " (" << 100.0 * g_evalCache.hitRate() << "%)\n";
         std::cout << "===========================\n";
 
         return 0;
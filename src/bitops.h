@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Máscara de cartas: bit i ligado = carta com cardId i
+using CardMask = uint64_t;
+
+inline CardMask cardBit(int id) { return 1ULL << id; }
+
+inline int popcount64(uint64_t x) {
+#if defined(_MSC_VER)
+    return (int)__popcnt64(x);
+#else
+    return __builtin_popcountll(x);
+#endif
+}
+
+// Índice do bit menos significativo (x != 0)
+inline int lsb64(uint64_t x) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward64(&idx, x);
+    return (int)idx;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+// Remove e devolve o bit menos significativo (x != 0)
+inline int popLsb(uint64_t& x) {
+    int i = lsb64(x);
+    x &= x - 1;
+    return i;
+}
+
+// Chama f(m) para cada subconjunto m de `avail` com s bits (s = 0..2)
+template <class F>
+void forEachSubset(CardMask avail, int s, F&& f) {
+    if (s == 0) { f(CardMask(0)); return; }
+    for (CardMask a = avail; a; ) {
+        int i = popLsb(a);
+        if (s == 1) { f(cardBit(i)); continue; }
+        for (CardMask b = a; b; ) f(cardBit(i) | cardBit(popLsb(b)));
+    }
+}
@@ -3,20 +3,99 @@
 #include <string>
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include "bitops.h"
 
-enum class Suit { Paus = 0, Ouros = 1, Copas = 2, Espadas = 3 };
-enum class Rank { R2, R3, R4, R5, R6, R10, J, Q, K, A };
+enum class Suit : uint8_t { Paus = 0, Ouros = 1, Copas = 2, Espadas = 3 };
+enum class Rank : uint8_t { R2, R3, R4, R5, R6, R10, J, Q, K, A };
 
 struct Card {
     Suit suit;
     Rank rank;
 };
 
+// Identificador compacto da carta [0..39] = naipe * 10 + rank
+// (é o mesmo índice usado nos inputs da NNUE)
+constexpr int NUM_CARDS = 40;
+
+constexpr int cardId(const Card& c) {
+    return (int)c.suit * 10 + (int)c.rank;
+}
+
+constexpr Card cardFromId(int id) {
+    return Card{ (Suit)(id / 10), (Rank)(id % 10) };
+}
+
+constexpr int suitOfId(int id) { return id / 10; }
+constexpr int rankOfId(int id) { return id % 10; }
+
+// Tabelas por rank (índice = (int)Rank)
+// Pontos: A=11, 10=10, K=4, J=3, Q=2, resto 0
+constexpr int8_t RANK_POINTS[10]   = { 0, 0, 0, 0, 0, 10, 3, 2, 4, 11 };
+// Força dentro do naipe: A > 10 > K > J > Q > 6 > 5 > 4 > 3 > 2
+constexpr int8_t RANK_STRENGTH[10] = { 0, 1, 2, 3, 4, 8, 6, 5, 7, 9 };
+
+// As mesmas tabelas indexadas pelo cardId (evita o id % 10)
+struct CardTable { int8_t v[NUM_CARDS]; constexpr int8_t operator[](int id) const { return v[id]; } };
+constexpr CardTable makeCardTable(const int8_t (&byRank)[10]) {
+    CardTable t{};
+    for (int id = 0; id < NUM_CARDS; ++id) t.v[id] = byRank[id % 10];
+    return t;
+}
+constexpr CardTable CARD_POINTS = makeCardTable(RANK_POINTS);
+constexpr CardTable CARD_STRENGTH = makeCardTable(RANK_STRENGTH);
+
+// ======================================================
+// Resolução da vaza por tabela
+//
+// A carta que vai ganhando uma vaza é sempre do naipe de saída ou trunfo,
+// por isso só é batida por uma do mesmo naipe mais forte ou, se não for
+// trunfo, por qualquer trunfo. BEATEN_BY[trunfo][w] é a máscara das
+// cartas que batem w: "c bate o vencedor atual" é um único bit, sem
+// precisar do naipe de saída.
+// ======================================================
+
+struct BeatTable {
+    CardMask m[4][NUM_CARDS];
+    constexpr const CardMask* operator[](int trump) const { return m[trump]; }
+};
+constexpr BeatTable makeBeatTable() {
+    BeatTable t{};
+    for (int trump = 0; trump < 4; ++trump)
+        for (int w = 0; w < NUM_CARDS; ++w)
+            for (int c = 0; c < NUM_CARDS; ++c) {
+                const bool beats = suitOfId(c) == suitOfId(w)
+                                       ? CARD_STRENGTH[c] > CARD_STRENGTH[w]
+                                       : suitOfId(c) == trump;
+                if (beats) t.m[trump][w] |= 1ULL << c;
+            }
+    return t;
+}
+constexpr BeatTable BEATEN_BY = makeBeatTable();
+
+constexpr bool cardBeats(int trumpSuit, int winnerId, int id) {
+    return (BEATEN_BY[trumpSuit][winnerId] >> id) & 1;
+}
+
+// Índice (0..count-1) da carta que ganha as `count` primeiras cartas da
+// vaza; sem saltos (cmov) quando count é constante
+inline int trickWinnerIndex(const uint8_t* cards, int count, int trumpSuit) {
+    int win = cards[0];
+    int winnerIndex = 0;
+    for (int i = 1; i < count; ++i) {
+        const int c = cards[i];
+        const bool b = cardBeats(trumpSuit, win, c);
+        win = b ? c : win;
+        winnerIndex = b ? i : winnerIndex;
+    }
+    return winnerIndex;
+}
+
 // Pontos da carta
-int cardPoints(const Card& c);
+constexpr int cardPoints(const Card& c) { return RANK_POINTS[(int)c.rank]; }
 
 // Força da carta dentro do mesmo naipe (maior número = carta mais forte)
-int cardStrength(const Card& c);
+constexpr int cardStrength(const Card& c) { return RANK_STRENGTH[(int)c.rank]; }
 
 // Helpers para debug/output
 std::string suitToString(Suit s);
@@ -0,0 +1,111 @@
+#include "endgame.h"
+#include "tablebase.h"
+#include <algorithm>
+#include <cassert>
+#include <memory>
+
+namespace {
+
+enum : uint8_t { EG_EXACT, EG_LOWER, EG_UPPER };
+
+struct EGEntry {
+    uint64_t key = 0;
+    int16_t value = 0;
+    uint8_t flag = EG_EXACT;
+    bool used = false;
+};
+
+constexpr int EG_TABLE_BITS = 14;
+
+struct EGTable {
+    std::unique_ptr<EGEntry[]> entries{ new EGEntry[1u << EG_TABLE_BITS] };
+};
+
+thread_local EGTable t_memo;
+
+inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Chave sem a pontuação: a margem que falta só depende das cartas,
+// da vaza atual, de quem joga e do naipe de trunfo.
+uint64_t endgameKey(const GameState& st) {
+    uint64_t t = (uint64_t)st.trick.count
+               | ((uint64_t)st.currentPlayer << 3)
+               | ((uint64_t)st.trumpSuit() << 4);
+    for (int i = 0; i < st.trick.count; ++i)
+        t |= (uint64_t)st.trick.cards[i] << (8 + 6 * i);
+    return mix64(st.hands[0] ^ 0x9E3779B97F4A7C15ULL)
+         ^ mix64(st.hands[1] + 0x632BE59BD9B4E019ULL)
+         ^ mix64(t + 0xC2B2AE3D27D4EB4FULL);
+}
+
+int solveRec(const GameState& st, int alpha, int beta, int* bestMoveOut) {
+    if (st.finished) return 0;
+
+    // início da penúltima vaza (4+4) ou última vaza: consulta O(1) na
+    // tablebase, se estiver carregada
+    int tbMargin;
+    if (!bestMoveOut && probeTablebase(st, tbMargin)) return tbMargin;
+
+    const int p = st.currentPlayer;
+    auto moves = st.getLegalMoves(p);
+    if (moves.empty()) return 0;
+
+    const uint64_t key = endgameKey(st);
+    EGEntry& e = t_memo.entries[key & ((1u << EG_TABLE_BITS) - 1)];
+    if (!bestMoveOut && e.used && e.key == key) {
+        if (e.flag == EG_EXACT) return e.value;
+        if (e.flag == EG_LOWER) alpha = std::max(alpha, (int)e.value);
+        else                    beta  = std::min(beta,  (int)e.value);
+        if (alpha >= beta) return e.value;
+    }
+
+    const int alphaOrig = alpha;
+    const int diffBefore = st.score[p] - st.score[1 - p];
+    static RNG noDrawRng(1234); // sem compras: o RNG não é usado
+
+    int best = -1000;
+    for (int m : moves) {
+        GameState ns = st;
+        ns.playCard(p, m);
+        ns.maybeCloseTrick(noDrawRng);
+
+        // pontos ganhos nesta jogada (só quando fecha a vaza)
+        int delta = (ns.score[p] - ns.score[1 - p]) - diffBefore;
+        int v = (ns.currentPlayer == p)
+              ? delta + solveRec(ns, alpha - delta, beta - delta, nullptr)
+              : delta - solveRec(ns, delta - beta, delta - alpha, nullptr);
+
+        if (v > best) {
+            best = v;
+            if (bestMoveOut) *bestMoveOut = m;
+        }
+        if (v > alpha) alpha = v;
+        if (alpha >= beta) break;
+    }
+
+    e.key = key;
+    e.value = (int16_t)best;
+    e.used = true;
+    e.flag = (best <= alphaOrig) ? EG_UPPER : (best >= beta) ? EG_LOWER : EG_EXACT;
+    return best;
+}
+
+} // namespace
+
+EndgameResult solveEndgame(const GameState& st) {
+    assert(st.noMoreCardsToDraw());
+    EndgameResult r;
+    r.margin = solveRec(st, -1000, 1000, &r.bestMove);
+    return r;
+}
+
+int endgameFinalDiff(const GameState& st, int player) {
+    int diff = st.score[player] - st.score[1 - player];
+    if (st.finished) return diff;
+    int margin = solveEndgame(st).margin;
+    return diff + (st.currentPlayer == player ? margin : -margin);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "gamestate.h"
+
+// ======================================================
+// Solver exato do fim de jogo
+//
+// Quando já não há compras (GameState::noMoreCardsToDraw) cada jogador tem
+// no máximo 4 cartas e a mão do adversário é dedutível (são as cartas que
+// faltam), por isso o resto do jogo resolve-se exatamente por alpha-beta
+// sobre a margem de pontos, sem NNUE. Usa uma pequena tabela de memo por
+// thread, independente da TT da pesquisa.
+// ======================================================
+
+struct EndgameResult {
+    // pontos que currentPlayer ainda ganha a mais do que o adversário
+    // daqui até ao fim (não inclui a pontuação atual)
+    int margin = 0;
+    // melhor jogada (índice na mão de currentPlayer), -1 se não houver
+    int bestMove = -1;
+};
+
+// Requer st.noMoreCardsToDraw()
+EndgameResult solveEndgame(const GameState& st);
+
+// Diferença final exata score[player] - score[1-player] com jogo perfeito
+int endgameFinalDiff(const GameState& st, int player);
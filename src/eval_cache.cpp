@@ -0,0 +1,136 @@
+#include "eval_cache.h"
+#include <cstring>
+#include <vector>
+
+NNUEEvalCache g_evalCache;
+
+// Entrada (64 bits):
+//   [ 0..31] value (bits do float)
+//   [32..63] bits altos da chave, com o bit 32 sempre a 1 (0 = vazia)
+namespace {
+
+constexpr uint64_t CHECK_MASK = 0xFFFFFFFF00000000ULL;
+constexpr uint64_t CHECK_SET  = 1ULL << 32;
+
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+} // namespace
+
+void NNUEEvalCache::resize(size_t mb) {
+    if (mb == 0) {
+        entries.reset();
+        mask = 0;
+        return;
+    }
+    size_t want = (mb << 20) / sizeof(Entry);
+    size_t n = 1;
+    while (n * 2 <= want) n *= 2;
+
+    entries.reset(new Entry[n]);
+    mask = n - 1;
+    clear();
+}
+
+void NNUEEvalCache::clear() {
+    if (!entries) return;
+    for (size_t i = 0; i <= mask; ++i) entries[i].store(0, std::memory_order_relaxed);
+    resetStats();
+}
+
+NNUEEvalCache::StatShard& NNUEEvalCache::statShard() const {
+    static std::atomic<int> nextShard{0};
+    thread_local const int shard = nextShard.fetch_add(1, std::memory_order_relaxed) % STAT_SHARDS;
+    return stats[shard];
+}
+
+uint64_t NNUEEvalCache::probes() const {
+    uint64_t n = 0;
+    for (const StatShard& s : stats) n += s.probes.load(std::memory_order_relaxed);
+    return n;
+}
+
+uint64_t NNUEEvalCache::hits() const {
+    uint64_t n = 0;
+    for (const StatShard& s : stats) n += s.hits.load(std::memory_order_relaxed);
+    return n;
+}
+
+void NNUEEvalCache::resetStats() {
+    for (StatShard& s : stats) {
+        s.probes.store(0, std::memory_order_relaxed);
+        s.hits.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint64_t NNUEEvalCache::key(const GameState& st, const NNUEWeights& w, int player, bool perfectInfo) {
+    const uint64_t net = mix64(w.id ^ mix64((uint64_t)(uintptr_t)w.quant.get()));
+    return st.hash ^ net ^ mix64(((uint64_t)player << 1) | (perfectInfo ? 1 : 0));
+}
+
+bool NNUEEvalCache::probe(uint64_t key, float& value) const {
+    if (!entries) return false;
+    StatShard& st = statShard();
+    st.probes.fetch_add(1, std::memory_order_relaxed);
+    const uint64_t e = entries[key & mask].load(std::memory_order_relaxed);
+    if ((e & CHECK_MASK) != ((key & CHECK_MASK) | CHECK_SET)) return false;
+    const uint32_t bits = (uint32_t)e;
+    std::memcpy(&value, &bits, sizeof(value));
+    st.hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void NNUEEvalCache::store(uint64_t key, float value) {
+    if (!entries) return;
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    entries[key & mask].store((key & CHECK_MASK) | CHECK_SET | bits, std::memory_order_relaxed);
+}
+
+float cachedEvaluate(const NNUEWeights& w, const GameState& st, int player, bool perfectInfo) {
+    if (!g_evalCache.enabled()) return nnueEvaluate(w, st, player, perfectInfo);
+    const uint64_t k = NNUEEvalCache::key(st, w, player, perfectInfo);
+    float v;
+    if (g_evalCache.probe(k, v)) return v;
+    v = nnueEvaluate(w, st, player, perfectInfo);
+    g_evalCache.store(k, v);
+    return v;
+}
+
+void cachedEvaluateBatch(const NNUEWeights& w, const GameState* states, const int* players,
+                         int n, bool perfectInfo, float* out)
+{
+    if (!g_evalCache.enabled()) {
+        nnueEvaluateBatch(w, states, players, n, perfectInfo, out);
+        return;
+    }
+
+    // as que faltam vão para o início de buffers locais
+    thread_local std::vector<GameState> missStates;
+    thread_local std::vector<int> missPlayers, missIdx;
+    thread_local std::vector<uint64_t> missKeys;
+    thread_local std::vector<float> missOut;
+    missStates.clear(); missPlayers.clear(); missIdx.clear(); missKeys.clear();
+
+    for (int i = 0; i < n; ++i) {
+        const uint64_t k = NNUEEvalCache::key(states[i], w, players[i], perfectInfo);
+        if (g_evalCache.probe(k, out[i])) continue;
+        missStates.push_back(states[i]);
+        missPlayers.push_back(players[i]);
+        missIdx.push_back(i);
+        missKeys.push_back(k);
+    }
+    if (missIdx.empty()) return;
+
+    const int m = (int)missIdx.size();
+    missOut.resize(m);
+    nnueEvaluateBatch(w, missStates.data(), missPlayers.data(), m, perfectInfo, missOut.data());
+    for (int j = 0; j < m; ++j) {
+        out[missIdx[j]] = missOut[j];
+        g_evalCache.store(missKeys[j], missOut[j]);
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "eval_nnue.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// ======================================================
+// Cache de avaliações NNUE
+//
+// Tabela direct-mapped (potência de 2) de entradas de 64 bits: 32 bits
+// de verificação da chave + o float da avaliação, escritos com um só
+// store atómico, por isso não há locks nem leituras rasgadas. A chave
+// junta o hash Zobrist da posição, a rede (NNUEWeights::id e a
+// quantizada), a perspetiva e perfectInfo; as avaliações são funções
+// puras da posição, logo a cache não precisa de ser limpa entre
+// pesquisas nem entre jogos. É partilhada pelo alpha-beta, quiescência,
+// ordenação na root e folhas do MCTS.
+// ======================================================
+
+class NNUEEvalCache {
+public:
+    static constexpr size_t DEFAULT_MB = 8;
+
+    explicit NNUEEvalCache(size_t mb = DEFAULT_MB) { resize(mb); }
+
+    // Realoca (e limpa) com ~mb megabytes; 0 desliga a cache
+    void resize(size_t mb);
+    void clear();
+
+    bool enabled() const { return entries != nullptr; }
+    size_t sizeMB() const { return entries ? ((mask + 1) * sizeof(Entry)) >> 20 : 0; }
+
+    static uint64_t key(const GameState& st, const NNUEWeights& w, int player, bool perfectInfo);
+
+    bool probe(uint64_t key, float& value) const;
+    void store(uint64_t key, float value);
+
+    // Estatísticas desde o último resetStats()
+    uint64_t probes() const;
+    uint64_t hits() const;
+    double hitRate() const { return probes() ? (double)hits() / probes() : 0.0; }
+    void resetStats();
+
+private:
+    using Entry = std::atomic<uint64_t>;
+
+    std::unique_ptr<Entry[]> entries;
+    size_t mask = 0;
+
+    // Contadores repartidos por cache lines: cada thread fica com uma
+    // (escolhida na 1ª sonda), para as sondas de threads diferentes não
+    // disputarem a mesma linha; probes()/hits() somam todas
+    static constexpr int STAT_SHARDS = 64;
+    struct alignas(64) StatShard {
+        std::atomic<uint64_t> probes{0};
+        std::atomic<uint64_t> hits{0};
+    };
+    mutable StatShard stats[STAT_SHARDS];
+
+    StatShard& statShard() const;
+};
+
+extern NNUEEvalCache g_evalCache;
+
+// nnueEvaluate através da g_evalCache
+float cachedEvaluate(const NNUEWeights& w, const GameState& st, int player, bool perfectInfo);
+
+// nnueEvaluateBatch através da g_evalCache: só as posições em falta são
+// avaliadas (num lote)
+void cachedEvaluateBatch(const NNUEWeights& w, const GameState* states, const int* players,
+                         int n, bool perfectInfo, float* out);
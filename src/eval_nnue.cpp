@@ -1,49 +1,15 @@
 #include "eval_nnue.h"
+#include "nnue_quant.h"
+#include "mapped_file.h"
 #include <fstream>
+#include <iostream>
 #include <cmath>
+#include <cstring>
+#include <array>
+#include <atomic>
+#include <algorithm>
 
-// Mapeia carta -> índice único [0..39] (naipe * 10 + rankIndex)
-static int cardIndex(const Card& c) {
-    int suitIdx = (int)c.suit; // Suit::Paus=0, Ouros=1, Copas=2, Espadas=3
-
-    int rankIdx = 0;
-    switch (c.rank) {
-        case Rank::R2:   rankIdx = 0; break;
-        case Rank::R3:   rankIdx = 1; break;
-        case Rank::R4:   rankIdx = 2; break;
-        case Rank::R5:   rankIdx = 3; break;
-        case Rank::R6:   rankIdx = 4; break;
-        case Rank::R10:  rankIdx = 5; break;
-        case Rank::J:    rankIdx = 6; break;
-        case Rank::Q:    rankIdx = 7; break;
-        case Rank::K:    rankIdx = 8; break;
-        case Rank::A:    rankIdx = 9; break;
-        default:         rankIdx = 0; break; // safety
-    }
-    return suitIdx * 10 + rankIdx;
-}
-
-// One-hot do rank de uma carta (10 posições fixas)
-// ordem: R2,R3,R4,R5,R6,R10,J,Q,K,A
-static void encodeTrumpRankOneHot(std::vector<float>& feat, int base, const Card& trumpCard) {
-    int idx = -1;
-    switch (trumpCard.rank) {
-        case Rank::R2:   idx = 0; break;
-        case Rank::R3:   idx = 1; break;
-        case Rank::R4:   idx = 2; break;
-        case Rank::R5:   idx = 3; break;
-        case Rank::R6:   idx = 4; break;
-        case Rank::R10:  idx = 5; break;
-        case Rank::J:    idx = 6; break;
-        case Rank::Q:    idx = 7; break;
-        case Rank::K:    idx = 8; break;
-        case Rank::A:    idx = 9; break;
-        default:         idx = -1; break;
-    }
-    if (idx >= 0 && idx < 10) {
-        feat[base + idx] = 1.0f;
-    }
-}
+float g_evalPerPoint = 0.01f;
 
 // NOVO INPUT LAYOUT (178 floats):
 //
@@ -79,99 +45,268 @@ std::vector<float> extractFeatures(const GameState& st,
 
     std::vector<float> feat(INPUT_SIZE, 0.0f);
 
-    int me  = player;
-    int opp = 1 - player;
+    NNUESparseFeatures sf;
+    extractSparseFeatures(st, player, perfectInfo, sf);
+    for (int i = 0; i < sf.count; ++i) feat[sf.active[i]] = 1.0f;
+    feat[120] = sf.scalar[0];
+    feat[121] = sf.scalar[1];
+    feat[122] = sf.scalar[2];
 
-    // --- [0..39] minhas cartas
-    for (auto &c : st.hands[me]) {
-        feat[ cardIndex(c) ] = 1.0f;
-    }
+    return feat;
+}
 
-    // --- [40..79] cartas do oponente (se perfectInfo)
-    if (perfectInfo) {
-        for (auto &c : st.hands[opp]) {
-            feat[40 + cardIndex(c)] = 1.0f;
-        }
-    }
-    // caso contrário, deixamos [40..79] a zeros.
+namespace {
+
+// perfectInfo como parâmetro de template: os blocos de cartas, a extração
+// esparsa e o update do acumulador ficam sem o teste por input, e as
+// funções públicas escolhem a instância uma só vez
+template <bool PerfectInfo>
+inline void cardBlocks(const NNUEFeatureState& fs, int p, CardMask out[4]) {
+    const CardMask oppCards = PerfectInfo ? fs.hands[1 - p] : 0;
+    out[0] = fs.hands[p];
+    out[1] = oppCards;
+    out[2] = fs.trick;
+    out[3] = fs.hands[p] | fs.trick | oppCards;
+}
 
-    // --- [80..119] cartas na trick atual (todas as que foram jogadas nesta vaza)
-    for (auto &c : st.trick.cards) {
-        feat[80 + cardIndex(c)] = 1.0f;
+template <bool PerfectInfo>
+void extractSparse(const NNUEFeatureState& fs, int player, NNUESparseFeatures& out) {
+    int n = 0;
+
+    // [0..39] minhas cartas, [40..79] opp (se perfectInfo), [80..119] vaza,
+    // [127..166] visíveis (o bit da máscara já é o cardId)
+    CardMask blocks[4];
+    cardBlocks<PerfectInfo>(fs, player, blocks);
+    for (int b = 0; b < 3; ++b) {
+        if (!PerfectInfo && b == 1) continue;
+        for (CardMask m = blocks[b]; m; ) out.active[n++] = (uint8_t)(NNUE_CARD_BLOCK_BASE[b] + popLsb(m));
     }
 
-    // --- [120], [121]: pontuação normalizada
-    feat[120] = st.score[me]  / 120.0f;
-    feat[121] = st.score[opp] / 120.0f;
+    // [123..126] naipe de trunfo
+    out.active[n++] = (uint8_t)(123 + suitOfId(fs.trumpId));
 
-    // --- [122]: fase do jogo (deck restante)
-    feat[122] = (float)st.deck.size() / 40.0f;
+    for (CardMask m = blocks[3]; m; ) out.active[n++] = (uint8_t)(NNUE_CARD_BLOCK_BASE[3] + popLsb(m));
 
-    // --- [123..126]: trunfo suit one-hot
-    {
-        int ts = (int)st.trumpSuit; // Suit::Paus=0, Ouros=1, Copas=2, Espadas=3
-        if (ts >= 0 && ts < 4) {
-            feat[123 + ts] = 1.0f;
-        }
-    }
+    // [167] trunfo já entregue, [168..177] rank da carta de trunfo
+    if (fs.trumpCardGiven) out.active[n++] = 167;
+    out.active[n++] = (uint8_t)(168 + rankOfId(fs.trumpId));
+    out.count = n;
 
-    // --- [127..166]: cartas visíveis/conhecidas
-    // definimos 40 floats, inicial 0.0
-    // marcamos 1.0 para:
-    //   - minha mão
-    //   - trick atual (pública)
-    //   - mão do adversário, mas só se temos perfectInfo (modo treino completo)
-    for (auto &c : st.hands[me]) {
-        feat[127 + cardIndex(c)] = 1.0f;
-    }
-    for (auto &c : st.trick.cards) {
-        feat[127 + cardIndex(c)] = 1.0f;
-    }
-    if (perfectInfo) {
-        for (auto &c : st.hands[opp]) {
-            feat[127 + cardIndex(c)] = 1.0f;
-        }
-    }
+    // [120..122] pontuações /120 e monte /40
+    out.scalar[0] = fs.score[player] / 120.0f;
+    out.scalar[1] = fs.score[1 - player] / 120.0f;
+    out.scalar[2] = fs.deckCount / 40.0f;
+}
 
-    // --- [167]: trunfo já foi dado ou não
-    // Se ainda NÃO foi dado (trumpCardGiven == false), significa que o prémio
-    // (a carta de trunfo virada no início) ainda está "por ganhar" quando o deck acabar.
-    feat[167] = st.trumpCardGiven ? 1.0f : 0.0f;
+} // namespace
 
-    // --- [168..177]: one-hot do rank da carta de trunfo inicial
-    encodeTrumpRankOneHot(feat, 168, st.trumpCard);
+void extractSparseFeatures(const NNUEFeatureState& fs, int player,
+                           bool perfectInfo, NNUESparseFeatures& out)
+{
+    if (perfectInfo) extractSparse<true>(fs, player, out);
+    else             extractSparse<false>(fs, player, out);
+}
 
-    return feat;
+void extractSparseFeatures(const GameState& st, int player,
+                           bool perfectInfo, NNUESparseFeatures& out)
+{
+    extractSparseFeatures(NNUEFeatureState::from(st), player, perfectInfo, out);
 }
 
+namespace {
+
+uint64_t nextWeightsId() {
+    static std::atomic<uint64_t> counter{0};
+    return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+} // namespace
+
 void initRandomWeights(NNUEWeights& w, int inputSize, RNG& rng) {
+    w.id = nextWeightsId();
     w.inputSize  = inputSize;
     w.hidden1 = 64;
     w.hidden2 = 32;
 
-    w.w1.resize(w.hidden1 * w.inputSize);
-    w.b1.resize(w.hidden1);
-    w.w2.resize(w.hidden2 * w.hidden1);
-    w.b2.resize(w.hidden2);
-    w.w3.resize(w.hidden2);
+    w.w1.assign(w.hidden1 * w.inputSize);
+    w.b1.assign(w.hidden1);
+    w.w2.assign(w.hidden2 * w.hidden1);
+    w.b2.assign(w.hidden2);
+    w.w3.assign(w.hidden2);
     w.b3 = 0.0f;
+    w.file.reset();
 
     auto randFloat = [&](float scale){
         return (float)((rng.nextDouble01() * 2.0 - 1.0) * scale);
     };
+    auto fill = [&](NNUEArray& a) {
+        float* p = a.mutableData();
+        for (size_t i = 0; i < a.size(); ++i) p[i] = randFloat(0.08f);
+    };
 
-    for (auto &x : w.w1) x = randFloat(0.08f);
-    for (auto &x : w.b1) x = randFloat(0.08f);
-    for (auto &x : w.w2) x = randFloat(0.08f);
-    for (auto &x : w.b2) x = randFloat(0.08f);
-    for (auto &x : w.w3) x = randFloat(0.08f);
+    fill(w.w1);
+    fill(w.b1);
+    fill(w.w2);
+    fill(w.b2);
+    fill(w.w3);
     w.b3 = randFloat(0.08f);
+
+    buildTransposedWeights(w);
 }
 
-float nnueEvaluate(const NNUEWeights& w,
-                   const GameState& st,
-                   int player,
-                   bool perfectInfo)
+namespace {
+
+// dst[c][r] = src[r][c]
+void transpose(const float* src, int rows, int cols, float* dst) {
+    for (int r = 0; r < rows; ++r)
+        for (int c = 0; c < cols; ++c)
+            dst[(size_t)c * rows + r] = src[(size_t)r * cols + c];
+}
+
+} // namespace
+
+void buildTransposedWeights(NNUEWeights& w) {
+    w.w1t.assign(w.w1.size());
+    transpose(w.w1.data(), w.hidden1, w.inputSize, w.w1t.mutableData());
+
+    w.w2t.assign(w.w2.size());
+    transpose(w.w2.data(), w.hidden2, w.hidden1, w.w2t.mutableData());
+}
+
+// ======================================================
+// Acumulador incremental
+// ======================================================
+
+NNUEFeatureState NNUEFeatureState::from(const GameState& st) {
+    NNUEFeatureState fs;
+    fs.hands[0] = st.hands[0];
+    fs.hands[1] = st.hands[1];
+    fs.trick = st.trick.mask();
+    fs.score[0] = st.score[0];
+    fs.score[1] = st.score[1];
+    fs.deckCount = st.deckCount;
+    fs.trumpId = st.trumpId;
+    fs.trumpCardGiven = st.trumpCardGiven;
+    return fs;
+}
+
+void nnueCardBlocks(const NNUEFeatureState& fs, int p, bool perfectInfo, CardMask out[4]) {
+    if (perfectInfo) cardBlocks<true>(fs, p, out);
+    else             cardBlocks<false>(fs, p, out);
+}
+
+namespace {
+
+inline void addColumn(const NNUEWeights& w, float* acc, int input, float scale) {
+    const float* col = &w.w1t[(size_t)input * w.hidden1];
+    for (int h = 0; h < w.hidden1; ++h) acc[h] += scale * col[h];
+}
+
+inline void addColumn(const NNUEWeights& w, float* acc, int input) {
+    const float* col = &w.w1t[(size_t)input * w.hidden1];
+    for (int h = 0; h < w.hidden1; ++h) acc[h] += col[h];
+}
+
+// Rede com o layout de 178 inputs, w1t/w2t construídas e camadas dentro
+// dos buffers fixos
+bool sparseUsable(const NNUEWeights& w) {
+    return w.inputSize == NNUE_INPUT_SIZE &&
+           w.hidden1 <= NNUE_MAX_HIDDEN1 &&
+           w.hidden2 <= NNUE_MAX_HIDDEN2 &&
+           w.w1t.size() == w.w1.size() &&
+           w.w2t.size() == w.w2.size();
+}
+
+// acc = b1 + soma das colunas de W1 dos inputs não nulos
+void sparseFirstLayer(const NNUEWeights& w, const NNUESparseFeatures& sf, float* acc) {
+    std::copy(w.b1.begin(), w.b1.end(), acc);
+    for (int i = 0; i < sf.count; ++i) addColumn(w, acc, sf.active[i]);
+    for (int k = 0; k < 3; ++k)
+        if (sf.scalar[k] != 0.0f) addColumn(w, acc, 120 + k, sf.scalar[k]);
+}
+
+void refreshAccumulator(const NNUEWeights& w, const NNUEFeatureState& fs,
+                        int p, bool perfectInfo, float* acc)
+{
+    NNUESparseFeatures sf;
+    extractSparseFeatures(fs, p, perfectInfo, sf);
+    sparseFirstLayer(w, sf, acc);
+}
+
+// acc (já com o valor de `from`) passa a ser o de `to`
+template <bool PerfectInfo>
+void updateAccumulator(const NNUEWeights& w, const NNUEFeatureState& from,
+                       const NNUEFeatureState& to, int p, float* acc)
+{
+    CardMask a[4], b[4];
+    cardBlocks<PerfectInfo>(from, p, a);
+    cardBlocks<PerfectInfo>(to, p, b);
+    for (int k = 0; k < 4; ++k) {
+        if (!PerfectInfo && k == 1) continue;
+        for (CardMask m = b[k] & ~a[k]; m; ) addColumn(w, acc, NNUE_CARD_BLOCK_BASE[k] + popLsb(m),  1.0f);
+        for (CardMask m = a[k] & ~b[k]; m; ) addColumn(w, acc, NNUE_CARD_BLOCK_BASE[k] + popLsb(m), -1.0f);
+    }
+
+    if (to.score[p] != from.score[p])
+        addColumn(w, acc, 120, (to.score[p] - from.score[p]) / 120.0f);
+    if (to.score[1 - p] != from.score[1 - p])
+        addColumn(w, acc, 121, (to.score[1 - p] - from.score[1 - p]) / 120.0f);
+    if (to.deckCount != from.deckCount)
+        addColumn(w, acc, 122, (to.deckCount - from.deckCount) / 40.0f);
+    if (to.trumpCardGiven != from.trumpCardGiven)
+        addColumn(w, acc, 167, to.trumpCardGiven ? 1.0f : -1.0f);
+}
+
+// ReLU(hidden1) -> hidden2 -> saída para n <= NNUE_BATCH posições
+// (pre[b] = pré-ativações de hidden1 da posição b).
+//
+// Produto com W2 transposta: para cada neurónio i de hidden1, a linha
+// w2t[i][0..h2) é lida uma vez e somada (axpy) a todas as posições do
+// bloco; os h1 que o ReLU pôs a zero (cerca de metade) saltam-se. O
+// ciclo interior é contíguo e sem redução, por isso vectoriza.
+void outputLayersBatch(const NNUEWeights& w, const float* const* pre, int n, float* out) {
+    const int H1 = w.hidden1, H2 = w.hidden2;
+    if (H2 == 0) { // redes antigas: h1 -> saída
+        for (int b = 0; b < n; ++b) {
+            float v = w.b3;
+            for (int i = 0; i < H1 && i < (int)w.w3.size(); ++i)
+                v += w.w3[i] * (pre[b][i] > 0.f ? pre[b][i] : 0.f);
+            out[b] = v;
+        }
+        return;
+    }
+
+    alignas(64) float z[NNUE_BATCH][NNUE_MAX_HIDDEN2];
+    for (int b = 0; b < n; ++b) std::copy(w.b2.begin(), w.b2.end(), z[b]);
+
+    for (int i = 0; i < H1; ++i) {
+        const float* row = &w.w2t[(size_t)i * H2];
+        for (int b = 0; b < n; ++b) {
+            const float x = pre[b][i];
+            if (x <= 0.f) continue;
+            float* zb = z[b];
+            for (int r = 0; r < H2; ++r) zb[r] += x * row[r];
+        }
+    }
+
+    for (int b = 0; b < n; ++b) {
+        float v = w.b3;
+        for (int r = 0; r < H2; ++r) v += w.w3[r] * (z[b][r] > 0.f ? z[b][r] : 0.f);
+        out[b] = v;
+    }
+}
+
+float outputLayers(const NNUEWeights& w, const float* pre) {
+    float out;
+    outputLayersBatch(w, &pre, 1, &out);
+    return out;
+}
+
+// Avaliação densa (redes fora do layout de 178 inputs / h1 acima do máximo)
+float denseEvaluate(const NNUEWeights& w,
+                    const GameState& st,
+                    int player,
+                    bool perfectInfo)
 {
     std::vector<float> in = extractFeatures(st, player, perfectInfo);
 
@@ -202,24 +337,320 @@ float nnueEvaluate(const NNUEWeights& w,
     return out;
 }
 
-bool saveWeights(const NNUEWeights& w, const std::string& path) {
-    std::ofstream f(path, std::ios::binary);
-    if (!f) return false;
-    // header: input, h1, h2
-    f.write((const char*)&w.inputSize,  sizeof(int));
-    f.write((const char*)&w.hidden1,    sizeof(int));
-    f.write((const char*)&w.hidden2,    sizeof(int));
-    // matrices
-    f.write((const char*)w.w1.data(),   w.w1.size()*sizeof(float));
-    f.write((const char*)w.b1.data(),   w.b1.size()*sizeof(float));
-    f.write((const char*)w.w2.data(),   w.w2.size()*sizeof(float));
-    f.write((const char*)w.b2.data(),   w.b2.size()*sizeof(float));
-    f.write((const char*)w.w3.data(),   w.w3.size()*sizeof(float));
-    f.write((const char*)&w.b3,         sizeof(float));
+} // namespace
+
+float nnueEvaluate(const NNUEWeights& w,
+                   const GameState& st,
+                   int player,
+                   bool perfectInfo)
+{
+    if (w.quant) return qnnueEvaluate(*w.quant, st, player, perfectInfo);
+    if (!sparseUsable(w)) return denseEvaluate(w, st, player, perfectInfo);
+
+    // sem alocações: features, hidden1 e hidden2 em buffers fixos
+    NNUESparseFeatures sf;
+    extractSparseFeatures(st, player, perfectInfo, sf);
+    alignas(64) float acc[NNUE_MAX_HIDDEN1];
+    sparseFirstLayer(w, sf, acc);
+    return outputLayers(w, acc);
+}
+
+namespace {
+
+template <bool PerfectInfo, class PlayerOf>
+void evaluateBatchImpl(const NNUEWeights& w, const GameState* states, int n,
+                       PlayerOf playerOf, float* out)
+{
+    if (w.quant || !sparseUsable(w)) {
+        for (int i = 0; i < n; ++i) out[i] = nnueEvaluate(w, states[i], playerOf(i), PerfectInfo);
+        return;
+    }
+
+    alignas(64) float acc[NNUE_BATCH][NNUE_MAX_HIDDEN1];
+    const float* pre[NNUE_BATCH];
+    for (int base = 0; base < n; base += NNUE_BATCH) {
+        const int m = std::min(NNUE_BATCH, n - base);
+        for (int b = 0; b < m; ++b) {
+            NNUESparseFeatures sf;
+            extractSparse<PerfectInfo>(NNUEFeatureState::from(states[base + b]), playerOf(base + b), sf);
+            sparseFirstLayer(w, sf, acc[b]);
+            pre[b] = acc[b];
+        }
+        outputLayersBatch(w, pre, m, out + base);
+    }
+}
+
+// Filhos do acumulador `parent` (estado `parentFs`): update + camadas em lote
+template <bool PerfectInfo>
+void evaluateChildrenFloat(const NNUEWeights& w, const NNUEFeatureState& parentFs,
+                           const float* parent, const GameState* children, int n,
+                           int player, float* out)
+{
+    alignas(64) float acc[NNUE_BATCH][NNUE_MAX_HIDDEN1];
+    const float* pre[NNUE_BATCH];
+    for (int base = 0; base < n; base += NNUE_BATCH) {
+        const int m = std::min(NNUE_BATCH, n - base);
+        for (int b = 0; b < m; ++b) {
+            const NNUEFeatureState fs = NNUEFeatureState::from(children[base + b]);
+            std::copy(parent, parent + w.hidden1, acc[b]);
+            updateAccumulator<PerfectInfo>(w, parentFs, fs, player, acc[b]);
+            pre[b] = acc[b];
+        }
+        outputLayersBatch(w, pre, m, out + base);
+    }
+}
+
+} // namespace
+
+void nnueEvaluateBatch(const NNUEWeights& w,
+                       const GameState* states,
+                       int n,
+                       int player,
+                       bool perfectInfo,
+                       float* out)
+{
+    auto playerOf = [player](int) { return player; };
+    if (perfectInfo) evaluateBatchImpl<true>(w, states, n, playerOf, out);
+    else             evaluateBatchImpl<false>(w, states, n, playerOf, out);
+}
+
+void nnueEvaluateBatch(const NNUEWeights& w,
+                       const GameState* states,
+                       const int* players,
+                       int n,
+                       bool perfectInfo,
+                       float* out)
+{
+    auto playerOf = [players](int i) { return players[i]; };
+    if (perfectInfo) evaluateBatchImpl<true>(w, states, n, playerOf, out);
+    else             evaluateBatchImpl<false>(w, states, n, playerOf, out);
+}
+
+void NNUEAccumulatorStack::reset(const NNUEWeights& weights, bool pi) {
+    w = &weights;
+    perfectInfo = pi;
+    usable = sparseUsable(weights);
+    quant = weights.quant.get();
+    size = 0;
+    if (stack.empty()) stack.resize(MAX_PLY);
+}
+
+void NNUEAccumulatorStack::push(const GameState& st) {
+    NNUEAccumulator& e = stack[size++];
+    e.fs = NNUEFeatureState::from(st);
+    e.st = &st;
+    e.computed[0] = e.computed[1] = false;
+}
+
+// Garante o acumulador do topo para `player` (a partir do antecessor
+// calculado mais próximo com o mesmo trunfo, ou de raiz)
+void NNUEAccumulatorStack::computeTop(int player) {
+    NNUEAccumulator& top = stack[size - 1];
+    if (top.computed[player]) return;
+
+    int j = size - 2;
+    while (j >= 0 && !(stack[j].computed[player] && stack[j].fs.trumpId == top.fs.trumpId)) --j;
+
+    if (quant) {
+        int16_t* acc = top.q[player];
+        if (j >= 0) {
+            std::copy(stack[j].q[player], stack[j].q[player] + quant->hidden1Padded, acc);
+            qnnueUpdate(*quant, stack[j].fs, top.fs, player, perfectInfo, acc);
+        } else {
+            qnnueRefresh(*quant, top.fs, player, perfectInfo, acc);
+        }
+    } else {
+        float* acc = top.h1[player];
+        if (j >= 0) {
+            std::copy(stack[j].h1[player], stack[j].h1[player] + w->hidden1, acc);
+            if (perfectInfo) updateAccumulator<true>(*w, stack[j].fs, top.fs, player, acc);
+            else             updateAccumulator<false>(*w, stack[j].fs, top.fs, player, acc);
+        } else {
+            refreshAccumulator(*w, top.fs, player, perfectInfo, acc);
+        }
+    }
+    top.computed[player] = true;
+}
+
+float NNUEAccumulatorStack::evaluate(int player) {
+    NNUEAccumulator& top = stack[size - 1];
+    if (!quant && !usable) return nnueEvaluate(*w, *top.st, player, perfectInfo);
+
+    computeTop(player);
+    if (quant) return qnnueOutput(*quant, top.q[player], top.fs, player);
+    return outputLayers(*w, top.h1[player]);
+}
+
+void NNUEAccumulatorStack::evaluateChildren(const GameState* children, int n,
+                                            int player, float* out)
+{
+    NNUEAccumulator& top = stack[size - 1];
+    if (!quant && !usable) {
+        nnueEvaluateBatch(*w, children, n, player, perfectInfo, out);
+        return;
+    }
+
+    computeTop(player);
+    if (quant) {
+        alignas(64) int16_t acc[NNUE_MAX_HIDDEN1];
+        for (int i = 0; i < n; ++i) {
+            const NNUEFeatureState fs = NNUEFeatureState::from(children[i]);
+            std::copy(top.q[player], top.q[player] + quant->hidden1Padded, acc);
+            qnnueUpdate(*quant, top.fs, fs, player, perfectInfo, acc);
+            out[i] = qnnueOutput(*quant, acc, fs, player);
+        }
+        return;
+    }
+
+    if (perfectInfo) evaluateChildrenFloat<true>(*w, top.fs, top.h1[player], children, n, player, out);
+    else             evaluateChildrenFloat<false>(*w, top.fs, top.h1[player], children, n, player, out);
+}
+
+// ======================================================
+// Ficheiro de pesos (ver eval_nnue.h)
+// ======================================================
+
+namespace {
+
+struct NNUEFileHeader {
+    char magic[4];         // "B4NN"
+    uint32_t version;      // NNUE_FILE_VERSION
+    uint32_t inputSize;
+    uint32_t hidden1;
+    uint32_t hidden2;
+    uint32_t sectionCount;
+    uint32_t checksum;     // CRC-32 de [sizeof(NNUEFileHeader), fileSize)
+    uint32_t reserved0;
+    uint64_t fileSize;
+    uint8_t reserved[24];
+};
+static_assert(sizeof(NNUEFileHeader) == 64, "cabeçalho NNUE tem de ter 64 bytes");
+
+struct NNUESectionDesc {
+    uint32_t id;           // NNUESectionId
+    uint32_t type;         // 0 = float32
+    uint32_t rows;
+    uint32_t cols;
+    uint64_t offset;       // desde o início do ficheiro, múltiplo de 64
+    uint64_t bytes;
+};
+static_assert(sizeof(NNUESectionDesc) == 32, "descritor NNUE tem de ter 32 bytes");
+
+enum NNUESectionId : uint32_t {
+    SEC_W1 = 1, SEC_W1T, SEC_B1, SEC_W2, SEC_W2T, SEC_B2, SEC_W3, SEC_B3,
+    SEC_COUNT
+};
+
+constexpr char NNUE_MAGIC[4] = { 'B', '4', 'N', 'N' };
+constexpr uint64_t NNUE_SECTION_ALIGN = 64;
+
+// CRC-32 (IEEE, o mesmo do zlib.crc32 do train_nnue.py)
+uint32_t crc32(const uint8_t* p, size_t n) {
+    static const auto table = []() {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < n; ++i) c = table[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+uint64_t alignUp(uint64_t x) {
+    return (x + NNUE_SECTION_ALIGN - 1) & ~(NNUE_SECTION_ALIGN - 1);
+}
+
+bool loadWeightsV2(NNUEWeights& w, const std::string& path,
+                   std::shared_ptr<MappedFile> file)
+{
+    const uint8_t* base = file->data();
+    const size_t size = file->size();
+
+    NNUEFileHeader hdr;
+    std::memcpy(&hdr, base, sizeof(hdr));
+    if (hdr.version != NNUE_FILE_VERSION) {
+        std::cerr << "NNUE '" << path << "': versão " << hdr.version
+                  << " não suportada (esperava " << NNUE_FILE_VERSION << ")\n";
+        return false;
+    }
+    const uint64_t descEnd = sizeof(hdr) + (uint64_t)hdr.sectionCount * sizeof(NNUESectionDesc);
+    if (hdr.fileSize != size || descEnd > size ||
+        hdr.inputSize == 0 || hdr.inputSize > 4096 ||
+        hdr.hidden1 == 0 || hdr.hidden1 > 4096 || hdr.hidden2 > 4096) {
+        std::cerr << "NNUE '" << path << "': cabeçalho inválido ou ficheiro truncado\n";
+        return false;
+    }
+    if (crc32(base + sizeof(hdr), size - sizeof(hdr)) != hdr.checksum) {
+        std::cerr << "NNUE '" << path << "': checksum errado\n";
+        return false;
+    }
+
+    const uint32_t I = hdr.inputSize, H1 = hdr.hidden1, H2 = hdr.hidden2;
+    // dimensões esperadas de cada secção (linhas, colunas)
+    const uint32_t expect[SEC_COUNT][2] = {
+        { 0, 0 }, { H1, I }, { I, H1 }, { 1, H1 },
+        { H2, H1 }, { H1, H2 }, { 1, H2 }, { 1, H2 ? H2 : H1 }, { 1, 1 }
+    };
+
+    const float* sec[SEC_COUNT] = {};
+    for (uint32_t k = 0; k < hdr.sectionCount; ++k) {
+        NNUESectionDesc d;
+        std::memcpy(&d, base + sizeof(hdr) + k * sizeof(d), sizeof(d));
+        if (d.id == 0 || d.id >= SEC_COUNT) continue; // secção desconhecida: ignora
+        const uint64_t count = (uint64_t)d.rows * d.cols;
+        if (d.type != 0 || d.rows != expect[d.id][0] || d.cols != expect[d.id][1] ||
+            d.bytes != count * sizeof(float) || d.offset % NNUE_SECTION_ALIGN != 0 ||
+            d.offset < descEnd || d.offset > size || d.bytes > size - d.offset) {
+            std::cerr << "NNUE '" << path << "': secção " << d.id << " inválida\n";
+            return false;
+        }
+        sec[d.id] = reinterpret_cast<const float*>(base + d.offset);
+    }
+    if (!sec[SEC_W1] || !sec[SEC_B1] || !sec[SEC_W3] || !sec[SEC_B3] ||
+        (H2 > 0 && (!sec[SEC_W2] || !sec[SEC_B2]))) {
+        std::cerr << "NNUE '" << path << "': faltam secções\n";
+        return false;
+    }
+
+    w.inputSize = (int)I;
+    w.hidden1 = (int)H1;
+    w.hidden2 = (int)H2;
+    w.w1.view(sec[SEC_W1], (size_t)H1 * I);
+    w.b1.view(sec[SEC_B1], H1);
+    if (H2 > 0) {
+        w.w2.view(sec[SEC_W2], (size_t)H2 * H1);
+        w.b2.view(sec[SEC_B2], H2);
+    } else {
+        w.w2.clear();
+        w.b2.clear();
+    }
+    w.w3.view(sec[SEC_W3], H2 ? H2 : H1);
+    w.b3 = sec[SEC_B3][0];
+
+    // transpostas: do ficheiro se lá estiverem, senão calculadas
+    if (sec[SEC_W1T]) {
+        w.w1t.view(sec[SEC_W1T], (size_t)I * H1);
+    } else {
+        w.w1t.assign(w.w1.size());
+        transpose(w.w1.data(), H1, I, w.w1t.mutableData());
+    }
+    if (sec[SEC_W2T] || H2 == 0) {
+        w.w2t.view(sec[SEC_W2T], (size_t)H1 * H2);
+    } else {
+        w.w2t.assign(w.w2.size());
+        transpose(w.w2.data(), H2, H1, w.w2t.mutableData());
+    }
+
+    w.file = std::move(file);
     return true;
 }
 
-bool loadWeights(NNUEWeights& w, const std::string& path) {
+// Formatos antigos sem cabeçalho: 2 ints (rede de 1 camada) ou 3 ints
+bool loadWeightsLegacy(NNUEWeights& w, const std::string& path) {
     std::ifstream f(path, std::ios::binary);
     if (!f) return false;
 
@@ -228,7 +659,6 @@ bool loadWeights(NNUEWeights& w, const std::string& path) {
     // Try to detect old format (2-int header) vs new (3-int header)
     std::streampos posAfterIn = f.tellg();
     f.read((char*)&h1, sizeof(int));
-    std::streampos posAfterH1 = f.tellg();
     f.read((char*)&h2, sizeof(int));
 
     bool oldFormat = false;
@@ -241,38 +671,118 @@ bool loadWeights(NNUEWeights& w, const std::string& path) {
         h2 = 0; // not used
     }
 
+    auto read = [&](NNUEArray& a, size_t n) {
+        a.assign(n);
+        f.read((char*)a.mutableData(), n * sizeof(float));
+    };
+
     w.inputSize = inSz;
+    w.file.reset();
     if (oldFormat) {
         // map old 1-hidden network into new by placing weights into layer1 and output
         w.hidden1 = h1;
         w.hidden2 = 0; // special case
 
-        w.w1.resize(w.hidden1 * w.inputSize);
-        w.b1.resize(w.hidden1);
+        read(w.w1, (size_t)w.hidden1 * w.inputSize);
+        read(w.b1, w.hidden1);
         w.w2.clear(); w.b2.clear();
-        w.w3.resize(w.hidden1);
-
-        f.read((char*)w.w1.data(), w.w1.size()*sizeof(float));
-        f.read((char*)w.b1.data(), w.b1.size()*sizeof(float));
-        f.read((char*)w.w3.data(), w.w3.size()*sizeof(float));
-        f.read((char*)&w.b3,       sizeof(float));
+        read(w.w3, w.hidden1);
+        f.read((char*)&w.b3, sizeof(float));
+        buildTransposedWeights(w);
         return true;
     }
 
     // new format
     w.hidden1 = h1;
     w.hidden2 = h2;
-    w.w1.resize(w.hidden1 * w.inputSize);
-    w.b1.resize(w.hidden1);
-    w.w2.resize(w.hidden2 * w.hidden1);
-    w.b2.resize(w.hidden2);
-    w.w3.resize(w.hidden2);
-
-    f.read((char*)w.w1.data(), w.w1.size()*sizeof(float));
-    f.read((char*)w.b1.data(), w.b1.size()*sizeof(float));
-    f.read((char*)w.w2.data(), w.w2.size()*sizeof(float));
-    f.read((char*)w.b2.data(), w.b2.size()*sizeof(float));
-    f.read((char*)w.w3.data(), w.w3.size()*sizeof(float));
-    f.read((char*)&w.b3,       sizeof(float));
+    read(w.w1, (size_t)w.hidden1 * w.inputSize);
+    read(w.b1, w.hidden1);
+    read(w.w2, (size_t)w.hidden2 * w.hidden1);
+    read(w.b2, w.hidden2);
+    read(w.w3, w.hidden2);
+    f.read((char*)&w.b3, sizeof(float));
+    buildTransposedWeights(w);
     return true;
 }
+
+} // namespace
+
+bool saveWeights(const NNUEWeights& w, const std::string& path) {
+    const int H1 = w.hidden1, H2 = w.hidden2, I = w.inputSize;
+
+    // transpostas sempre recalculadas, para ficarem coerentes com w1/w2
+    std::vector<float> w1t(w.w1.size()), w2t(w.w2.size());
+    transpose(w.w1.data(), H1, I, w1t.data());
+    if (H2 > 0) transpose(w.w2.data(), H2, H1, w2t.data());
+
+    struct Src { uint32_t id, rows, cols; const float* p; };
+    std::vector<Src> secs = {
+        { SEC_W1, (uint32_t)H1, (uint32_t)I, w.w1.data() },
+        { SEC_W1T, (uint32_t)I, (uint32_t)H1, w1t.data() },
+        { SEC_B1, 1, (uint32_t)H1, w.b1.data() },
+    };
+    if (H2 > 0) {
+        secs.push_back({ SEC_W2, (uint32_t)H2, (uint32_t)H1, w.w2.data() });
+        secs.push_back({ SEC_W2T, (uint32_t)H1, (uint32_t)H2, w2t.data() });
+        secs.push_back({ SEC_B2, 1, (uint32_t)H2, w.b2.data() });
+    }
+    secs.push_back({ SEC_W3, 1, (uint32_t)(H2 ? H2 : H1), w.w3.data() });
+    secs.push_back({ SEC_B3, 1, 1, &w.b3 });
+
+    NNUEFileHeader hdr{};
+    std::memcpy(hdr.magic, NNUE_MAGIC, 4);
+    hdr.version = NNUE_FILE_VERSION;
+    hdr.inputSize = (uint32_t)I;
+    hdr.hidden1 = (uint32_t)H1;
+    hdr.hidden2 = (uint32_t)H2;
+    hdr.sectionCount = (uint32_t)secs.size();
+
+    // monta o ficheiro em memória: descritores e secções alinhadas
+    uint64_t off = alignUp(sizeof(hdr) + secs.size() * sizeof(NNUESectionDesc));
+    std::vector<NNUESectionDesc> desc;
+    for (const Src& s : secs) {
+        NNUESectionDesc d{};
+        d.id = s.id;
+        d.type = 0;
+        d.rows = s.rows;
+        d.cols = s.cols;
+        d.offset = off;
+        d.bytes = (uint64_t)s.rows * s.cols * sizeof(float);
+        desc.push_back(d);
+        off = alignUp(off + d.bytes);
+    }
+    hdr.fileSize = off;
+
+    std::vector<uint8_t> buf(off, 0);
+    std::memcpy(buf.data() + sizeof(hdr), desc.data(), desc.size() * sizeof(NNUESectionDesc));
+    for (size_t k = 0; k < secs.size(); ++k)
+        std::memcpy(buf.data() + desc[k].offset, secs[k].p, desc[k].bytes);
+    hdr.checksum = crc32(buf.data() + sizeof(hdr), buf.size() - sizeof(hdr));
+    std::memcpy(buf.data(), &hdr, sizeof(hdr));
+
+    // nunca reescrever no sítio: um motor pode ter esta rede mapeada
+    return writeFileAtomic(path, buf.data(), buf.size());
+}
+
+bool loadWeights(NNUEWeights& w, const std::string& path) {
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(path)) return false;
+
+    bool ok;
+    if (file->size() >= sizeof(NNUEFileHeader) &&
+        std::memcmp(file->data(), NNUE_MAGIC, 4) == 0) {
+        ok = loadWeightsV2(w, path, std::move(file));
+    } else {
+        file.reset();
+        ok = loadWeightsLegacy(w, path);
+    }
+    if (ok) w.id = nextWeightsId();
+    return ok;
+}
+
+void detachWeights(NNUEWeights& w) {
+    if (!w.file) return;
+    for (NNUEArray* a : { &w.w1, &w.w1t, &w.b1, &w.w2, &w.w2t, &w.b2, &w.w3 })
+        a->own();
+    w.file.reset();
+}
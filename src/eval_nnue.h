@@ -3,25 +3,94 @@
 #include "rand.h"
 #include <vector>
 #include <cstdint>
+#include <memory>
 #include <string>
 
 // NNUE-style evaluator
 
+struct QuantizedNNUE; // nnue_quant.h
+class MappedFile;     // mapped_file.h
+
+// Array de floats da rede: ou é dono dos dados, ou é uma vista só de
+// leitura sobre o ficheiro de pesos mapeado (formato v2). O acesso é
+// sempre const; para escrever usa-se assign() + mutableData().
+class NNUEArray {
+public:
+    NNUEArray() = default;
+    NNUEArray(const NNUEArray& o) { *this = o; }
+    NNUEArray& operator=(const NNUEArray& o) {
+        if (this == &o) return *this;
+        owned = o.owned;
+        n = o.n;
+        ptr = o.ownsData() ? owned.data() : o.ptr;
+        return *this;
+    }
+
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+    const float* data() const { return ptr; }
+    const float* begin() const { return ptr; }
+    const float* end() const { return ptr + n; }
+    const float& operator[](size_t i) const { return ptr[i]; }
+
+    // Passa a ser dono de n floats com o valor v
+    void assign(size_t count, float v = 0.0f) {
+        owned.assign(count, v);
+        ptr = owned.data();
+        n = count;
+    }
+    void clear() { assign(0); }
+    // Vista sobre memória de outro dono (tem de viver mais que o array)
+    void view(const float* p, size_t count) {
+        owned.clear();
+        owned.shrink_to_fit();
+        ptr = p;
+        n = count;
+    }
+
+    bool ownsData() const { return ptr == owned.data(); }
+    // Copia os dados de uma vista para memória própria
+    void own() {
+        if (ownsData()) return;
+        owned.assign(ptr, ptr + n);
+        ptr = owned.data();
+    }
+    float* mutableData() { return ownsData() ? owned.data() : nullptr; }
+
+private:
+    std::vector<float> owned;
+    const float* ptr = nullptr;
+    size_t n = 0;
+};
+
 struct NNUEWeights {
     // 2 hidden layers: h1=64, h2=32 (por defeito)
-    std::vector<float> w1; // [h1][input]
-    std::vector<float> b1; // [h1]
-    std::vector<float> w2; // [h2][h1]
-    std::vector<float> b2; // [h2]
-    std::vector<float> w3; // [1][h2]
-    float b3 = 0.0f;       // [1]
+    NNUEArray w1;  // [h1][input]
+    NNUEArray w1t; // [input][h1] = w1 transposta (colunas do acumulador)
+    NNUEArray b1;  // [h1]
+    NNUEArray w2;  // [h2][h1]
+    NNUEArray w2t; // [h1][h2] = w2 transposta (produto em lote)
+    NNUEArray b2;  // [h2]
+    NNUEArray w3;  // [1][h2]
+    float b3 = 0.0f; // [1]
 
     int inputSize = 0;
     int hidden1 = 64;
     int hidden2 = 32;
+
+    // Identifica a rede na cache de avaliação (eval_cache.h): novo a cada
+    // loadWeights/initRandomWeights, partilhado pelas cópias
+    uint64_t id = 0;
+
+    // Ficheiro v2 mapeado de onde vêm as vistas (partilhado pelas cópias)
+    std::shared_ptr<const MappedFile> file;
+
+    // Se presente, nnueEvaluate e os acumuladores usam a versão quantizada
+    std::shared_ptr<const QuantizedNNUE> quant;
 };
 
-// Agora o extractFeatures gera 178 floats:
+// Agora o extractFeatures gera 178 floats (versão densa, para os datasets;
+// a avaliação usa extractSparseFeatures):
 // 0..39   minhas cartas
 // 40..79  cartas opp (se perfectInfo)
 // 80..119 trick atual
@@ -39,6 +108,11 @@ std::vector<float> extractFeatures(const GameState& st,
                                    int player,
                                    bool perfectInfo);
 
+// Escala da eval: a rede é treinada com target = diff de pontos * lambda-scale
+// (--lambda-scale do train_nnue.py, 0.01 no auto.bat), logo 1 ponto de jogo
+// vale ~g_evalPerPoint unidades de eval.
+extern float g_evalPerPoint;
+
 // Inicializa pesos random
 void initRandomWeights(NNUEWeights& w, int inputSize, RNG& rng);
 
@@ -48,6 +122,149 @@ float nnueEvaluate(const NNUEWeights& w,
                    int player,
                    bool perfectInfo);
 
-// guardar/carregar pesos
+// Avalia n posições do ponto de vista de `player`: out[i] é o mesmo que
+// nnueEvaluate(w, states[i], player, perfectInfo). As camadas correm em
+// blocos de NNUE_BATCH posições como produtos matriz-matriz, lendo cada
+// linha de pesos uma só vez por bloco.
+void nnueEvaluateBatch(const NNUEWeights& w,
+                       const GameState* states,
+                       int n,
+                       int player,
+                       bool perfectInfo,
+                       float* out);
+
+// Idem com um jogador (ponto de vista) por posição
+void nnueEvaluateBatch(const NNUEWeights& w,
+                       const GameState* states,
+                       const int* players,
+                       int n,
+                       bool perfectInfo,
+                       float* out);
+
+// Preenche w1t e w2t a partir de w1/w2 (loadWeights/initRandomWeights já
+// o fazem; só é preciso se os pesos forem alterados à mão)
+void buildTransposedWeights(NNUEWeights& w);
+
+// ======================================================
+// Acumulador incremental da 1ª camada
+//
+// Guarda as pré-ativações de hidden1 (b1 + W1*in) de cada perspetiva.
+// Uma jogada só muda meia dúzia de inputs (carta sai da mão, entra na
+// vaza, compras, pontuação, monte), por isso o acumulador de um nó
+// obtém-se do de um antecessor somando/subtraindo as colunas de W1
+// que mudaram. Na pesquisa usamos uma pilha por ply: push ao entrar no
+// nó, pop ao sair, e só calculamos (lazy) quando há uma avaliação; aí
+// a folha custa apenas as camadas 64x32 e 32x1.
+// ======================================================
+
+constexpr int NNUE_INPUT_SIZE = 178;
+constexpr int NNUE_MAX_HIDDEN1 = 256;
+constexpr int NNUE_MAX_HIDDEN2 = 256;
+constexpr int NNUE_BATCH = 16; // posições por bloco em nnueEvaluateBatch
+
+// Tudo o que as features leem de um GameState
+struct NNUEFeatureState {
+    CardMask hands[2];
+    CardMask trick;
+    int16_t score[2];
+    uint8_t deckCount;
+    uint8_t trumpId;
+    bool trumpCardGiven;
+
+    static NNUEFeatureState from(const GameState& st);
+};
+
+// Inputs binários em 4 blocos de 40 cartas: mão, mão do adversário (só com
+// perfectInfo), vaza e cartas visíveis (ver extractFeatures)
+constexpr int NNUE_CARD_BLOCK_BASE[4] = { 0, 40, 80, 127 };
+void nnueCardBlocks(const NNUEFeatureState& fs, int player, bool perfectInfo, CardMask out[4]);
+
+// ======================================================
+// Features esparsas
+//
+// Dos 178 inputs só ~20 são não nulos: os binários a 1 (cartas, trunfo,
+// trumpCardGiven) e os 3 escalares (120..122). A lista de índices vai para
+// um buffer do chamador; a 1ª camada soma só essas colunas de W1.
+// ======================================================
+
+// Limite para qualquer estado (os blocos de cartas têm no máx. 40+40 bits);
+// num jogo normal são <= 19
+constexpr int NNUE_MAX_ACTIVE = 88;
+
+struct NNUESparseFeatures {
+    uint8_t active[NNUE_MAX_ACTIVE]; // inputs binários a 1.0
+    int count = 0;
+    float scalar[3];                 // inputs 120 (eu), 121 (opp), 122 (monte)
+};
+
+void extractSparseFeatures(const NNUEFeatureState& fs, int player,
+                           bool perfectInfo, NNUESparseFeatures& out);
+void extractSparseFeatures(const GameState& st, int player,
+                           bool perfectInfo, NNUESparseFeatures& out);
+
+struct NNUEAccumulator {
+    alignas(64) float h1[2][NNUE_MAX_HIDDEN1]; // pré-ReLU, por perspetiva
+    alignas(64) int16_t q[2][NNUE_MAX_HIDDEN1]; // idem na rede quantizada (só inputs binários)
+    bool computed[2] = { false, false };
+    NNUEFeatureState fs;
+    const GameState* st = nullptr; // para o fallback sem acumulador
+};
+
+class NNUEAccumulatorStack {
+public:
+    static constexpr int MAX_PLY = 64;
+
+    // Início de cada pesquisa (pilha vazia)
+    void reset(const NNUEWeights& w, bool perfectInfo);
+
+    // `st` tem de continuar vivo até ao pop correspondente
+    void push(const GameState& st);
+    void pop() { --size; }
+
+    // Igual a nnueEvaluate(w, topo, player, perfectInfo)
+    float evaluate(int player);
+
+    // Avalia em lote os filhos do topo (posições a um lance dele, sem push):
+    // cada acumulador sai do topo por update e as camadas seguintes correm
+    // como em nnueEvaluateBatch
+    void evaluateChildren(const GameState* children, int n, int player, float* out);
+
+private:
+    void computeTop(int player);
+
+    const NNUEWeights* w = nullptr;
+    bool perfectInfo = false;
+    bool usable = false; // rede com o layout de 178 inputs e h1 <= máximo
+    const QuantizedNNUE* quant = nullptr;
+    int size = 0;
+    std::vector<NNUEAccumulator> stack;
+};
+
+// ======================================================
+// Ficheiro de pesos
+//
+// Formato v2 (little-endian), o que saveWeights escreve:
+//   cabeçalho de 64 bytes: "B4NN", versão, input/h1/h2, nº de secções,
+//     CRC-32 de tudo o que vem depois do cabeçalho, tamanho do ficheiro
+//   descritores de secção (32 bytes): id, tipo, linhas, colunas,
+//     offset e tamanho em bytes
+//   secções float32 (w1, w1t, b1, w2, w2t, b2, w3, b3), cada uma
+//     alinhada a 64 bytes
+//
+// loadWeights mapeia o ficheiro (mmap) e as matrizes ficam vistas sobre
+// ele: não há cópias nem transpostas a calcular, e todos os processos que
+// usam a mesma rede partilham as páginas da page cache. Os formatos
+// antigos sem cabeçalho (2 ou 3 ints) continuam a ser lidos, por cópia.
+//
+// Por isso uma rede mapeada nunca pode ser reescrita no sítio: saveWeights
+// (e o train_nnue.py) gravam num ficheiro temporário e fazem rename por
+// cima, e quem a tem mapeada continua a ver a versão antiga.
+// ======================================================
+
+constexpr uint32_t NNUE_FILE_VERSION = 2;
+
 bool saveWeights(const NNUEWeights& w, const std::string& path);
 bool loadWeights(NNUEWeights& w, const std::string& path);
+// Copia as matrizes vistas sobre o ficheiro para memória própria e larga o
+// mapeamento: a rede deixa de depender do que acontecer ao ficheiro
+void detachWeights(NNUEWeights& w);
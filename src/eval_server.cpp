@@ -0,0 +1,135 @@
+#include "eval_server.h"
+#include "eval_cache.h"
+#include <algorithm>
+#include <chrono>
+
+NNUEEvalServer::NNUEEvalServer(const NNUEWeights& weights, bool pi, const EvalServerConfig& c)
+    : w(weights), perfectInfo(pi), cfg(c)
+{
+    const int n = std::max(1, cfg.threads);
+    workers.reserve(n);
+    for (int i = 0; i < n; ++i) workers.emplace_back([this]() { workerLoop(); });
+}
+
+NNUEEvalServer::~NNUEEvalServer() {
+    {
+        std::lock_guard<std::mutex> lk(m);
+        stopping = true;
+    }
+    cv.notify_all();
+    for (auto& th : workers) th.join();
+}
+
+void NNUEEvalServer::attach() {
+    std::lock_guard<std::mutex> lk(m);
+    ++clients;
+}
+
+void NNUEEvalServer::detach() {
+    {
+        std::lock_guard<std::mutex> lk(m);
+        --clients;
+    }
+    // com menos clientes o lote pendente pode já estar completo
+    cv.notify_all();
+}
+
+bool NNUEEvalServer::batchReady() const {
+    return (int)queue.size() >= std::max(1, cfg.maxBatch) ||
+           (clients > 0 && waitingClients >= clients);
+}
+
+void NNUEEvalServer::evaluateMany(const GameState* states, const int* players, int n, float* out) {
+    if (n <= 0) return;
+
+    // o que está na cache responde-se já
+    const bool useCache = g_evalCache.enabled();
+    thread_local std::vector<Request> pending;
+    pending.clear();
+    Ticket t;
+    for (int i = 0; i < n; ++i) {
+        uint64_t key = 0;
+        if (useCache) {
+            key = NNUEEvalCache::key(states[i], w, players[i], perfectInfo);
+            if (g_evalCache.probe(key, out[i])) continue;
+        }
+        pending.push_back(Request{ &states[i], players[i], key, &out[i], &t });
+    }
+    if (pending.empty()) return;
+
+    t.remaining = (int)pending.size();
+    {
+        std::lock_guard<std::mutex> lk(m);
+        queue.insert(queue.end(), pending.begin(), pending.end());
+        ++waitingClients;
+        // acorda um servidor no primeiro pedido e quando o lote fica pronto
+        if (queue.size() == pending.size() || batchReady()) cv.notify_one();
+    }
+    {
+        std::unique_lock<std::mutex> tl(t.m);
+        t.cv.wait(tl, [&]() { return t.remaining == 0; });
+    }
+    std::lock_guard<std::mutex> lk(m);
+    --waitingClients;
+}
+
+float NNUEEvalServer::evaluate(const GameState& st, int player) {
+    float v = 0.0f;
+    evaluateMany(&st, &player, 1, &v);
+    return v;
+}
+
+void NNUEEvalServer::workerLoop() {
+    const int maxBatch = std::max(1, cfg.maxBatch);
+    std::vector<Request> batch;
+    std::vector<GameState> states;
+    std::vector<int> players;
+    std::vector<float> out;
+    batch.reserve(maxBatch);
+    states.reserve(maxBatch);
+    players.reserve(maxBatch);
+    out.resize(maxBatch);
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(m);
+            cv.wait(lk, [&]() { return stopping || !queue.empty(); });
+            if (queue.empty()) return; // stopping
+
+            if (!batchReady() && cfg.maxWaitMicros > 0 && !stopping) {
+                cv.wait_for(lk, std::chrono::microseconds(cfg.maxWaitMicros), [&]() {
+                    return stopping || batchReady();
+                });
+            }
+            if (queue.empty()) continue; // outra thread levou o lote
+
+            const int n = std::min<int>(maxBatch, (int)queue.size());
+            batch.assign(queue.begin(), queue.begin() + n);
+            queue.erase(queue.begin(), queue.begin() + n);
+            if (!queue.empty()) cv.notify_one();
+        }
+
+        states.clear();
+        players.clear();
+        for (const Request& r : batch) {
+            states.push_back(*r.st);
+            players.push_back(r.player);
+        }
+        const int n = (int)batch.size();
+        nnueEvaluateBatch(w, states.data(), players.data(), n, perfectInfo, out.data());
+        if (g_evalCache.enabled())
+            for (int i = 0; i < n; ++i) g_evalCache.store(batch[i].cacheKey, out[i]);
+
+        for (int i = 0; i < n; ++i) {
+            // notify com o lock: o Ticket vive na stack do cliente e
+            // deixa de existir assim que ele acorda
+            Ticket* t = batch[i].ticket;
+            std::lock_guard<std::mutex> tl(t->m);
+            *batch[i].out = out[i];
+            if (--t->remaining == 0) t->cv.notify_one();
+        }
+
+        evals.fetch_add(n, std::memory_order_relaxed);
+        batches.fetch_add(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "eval_nnue.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ======================================================
+// Servidor de avaliação NNUE em lote
+//
+// Para o self-play: cada worker intercala vários jogos (pesquisas MCTS
+// retomáveis) e entrega as folhas de todos de uma vez com
+// evaluateMany(); as threads do servidor juntam os pedidos pendentes de
+// todos os workers e correm-nos com nnueEvaluateBatch em lotes de até
+// maxBatch posições. Um lote corre logo que todos os clientes registados
+// (Client) estão à espera; senão espera no máx. maxWaitMicros por mais
+// pedidos. As posições que já estão na g_evalCache nem chegam à fila.
+// ======================================================
+
+struct EvalServerConfig {
+    int threads = 1;         // threads de avaliação
+    int maxBatch = 256;
+    int maxWaitMicros = 200; // 0 -> corre logo o que houver
+};
+
+class NNUEEvalServer {
+public:
+    NNUEEvalServer(const NNUEWeights& w, bool perfectInfo, const EvalServerConfig& cfg);
+    ~NNUEEvalServer();
+
+    NNUEEvalServer(const NNUEEvalServer&) = delete;
+    NNUEEvalServer& operator=(const NNUEEvalServer&) = delete;
+
+    // Bloqueia até as n posições estarem avaliadas; out[i] é o mesmo que
+    // nnueEvaluate(w, states[i], players[i], perfectInfo)
+    void evaluateMany(const GameState* states, const int* players, int n, float* out);
+    float evaluate(const GameState& st, int player);
+
+    // Regista a thread cliente enquanto existir (uma por worker)
+    class Client {
+    public:
+        explicit Client(NNUEEvalServer* s) : server(s) { if (server) server->attach(); }
+        ~Client() { if (server) server->detach(); }
+        Client(const Client&) = delete;
+        Client& operator=(const Client&) = delete;
+    private:
+        NNUEEvalServer* server;
+    };
+
+    uint64_t evalCount() const { return evals.load(std::memory_order_relaxed); }
+    uint64_t batchCount() const { return batches.load(std::memory_order_relaxed); }
+
+private:
+    struct Ticket {
+        std::mutex m;
+        std::condition_variable cv;
+        int remaining = 0;
+    };
+    struct Request {
+        const GameState* st; // vive no cliente até o Ticket acabar
+        int player;
+        uint64_t cacheKey;
+        float* out;
+        Ticket* ticket;
+    };
+
+    void workerLoop();
+    void attach();
+    void detach();
+    bool batchReady() const; // com m bloqueado
+
+    const NNUEWeights& w;
+    const bool perfectInfo;
+    const EvalServerConfig cfg;
+
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<Request> queue;
+    bool stopping = false;
+    int clients = 0;
+    int waitingClients = 0; // clientes com pedidos por acabar
+    std::vector<std::thread> workers;
+
+    std::atomic<uint64_t> evals{0};
+    std::atomic<uint64_t> batches{0};
+};
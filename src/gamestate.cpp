@@ -2,98 +2,14 @@
 #include "card.h"
 #include <cassert>
 #include <sstream>
-#include <vector>
 #include <utility>
 #include <cstdint>
 #include <chrono>
 
-// ======================
-// Helpers de texto/cartas
-// ======================
-
-// Converte Suit -> nome em português
-static std::string suitName(Suit s) {
-    switch (s) {
-    case Suit::Ouros:   return "Ouros";
-    case Suit::Copas:   return "Copas";
-    case Suit::Espadas: return "Espadas";
-    case Suit::Paus:    return "Paus";
-    default:            return "?";
-    }
-}
-
-// Converte Rank -> "A", "K", "Q", "J", "10", "6", etc.
-static std::string rankName(Rank r) {
-    switch (r) {
-    case Rank::A:   return "A";
-    case Rank::K:   return "K";
-    case Rank::Q:   return "Q";
-    case Rank::J:   return "J";
-    case Rank::R10: return "10";
-    case Rank::R6:  return "6";
-    case Rank::R5:  return "5";
-    case Rank::R4:  return "4";
-    case Rank::R3:  return "3";
-    case Rank::R2:  return "2";
-    default:        return "?";
-    }
-}
-
-// "A de Espadas", "10 de Ouros", etc.
-static std::string cardToString(const Card& c) {
-    std::ostringstream ss;
-    ss << rankName(c.rank) << " de " << suitName(c.suit);
-    return ss.str();
-}
-
-// Pontos de uma carta individual segundo as regras:
-// Dama(Q)=2, Valete(J)=3, Rei(K)=4, 10=10, Ás(A)=11
-static int cardPointsLocal(const Card& c) {
-    switch (c.rank) {
-    case Rank::Q:   return 2;
-    case Rank::J:   return 3;
-    case Rank::K:   return 4;
-    case Rank::R10: return 10;
-    case Rank::A:   return 11;
-    default:        return 0;
-    }
-}
-
-// Isto já existe no teu código original
-extern int cardStrength(const Card& c);
-
-// Dado o índice i na trick (0..3), quem jogou a carta trick.cards[i]?
-static int playerOfIndex(const Trick& t, int idx) {
-    if (idx % 2 == 0) return t.starterPlayer;
-    return 1 - t.starterPlayer;
-}
-
 // ======================
 // Funções auxiliares para o baralho
 // ======================
 
-// A bisca dos 4 usa: 2,3,4,5,6,10,J,Q,K,A (sem 7,8,9)
-static std::vector<Card> makeDeckLocal() {
-    std::vector<Card> d;
-    d.reserve(40);
-
-    const Rank ranksWanted[] = {
-        Rank::R2, Rank::R3, Rank::R4, Rank::R5, Rank::R6,
-        Rank::R10, Rank::J, Rank::Q, Rank::K, Rank::A
-    };
-
-    for (int s = 0; s < 4; ++s) {
-        for (auto r : ranksWanted) {
-            Card c;
-            c.suit = static_cast<Suit>(s);
-            c.rank = r;
-            d.push_back(c);
-        }
-    }
-
-    return d;
-}
-
 // Shuffle pseudo-aleatório independente do RNG do projeto
 static uint64_t localSeed() {
     auto now = std::chrono::high_resolution_clock::now()
@@ -113,15 +29,57 @@ static uint64_t next64(uint64_t &s) {
     return s;
 }
 
-static void shuffleDeckLocal(std::vector<Card>& d) {
+static void shuffleDeckLocal(uint8_t* d, int n) {
     uint64_t s = localSeed();
-    for (int i = (int)d.size() - 1; i > 0; --i) {
+    for (int i = n - 1; i > 0; --i) {
         uint64_t r = next64(s);
         int j = (int)(r % (uint64_t)(i + 1));
         std::swap(d[i], d[j]);
     }
 }
 
+// ======================
+// Chaves Zobrist
+// ======================
+//
+// Uma chave por (carta, zona, dono): mão de cada jogador, posição no monte
+// e posição na vaza. Mais a carta de trunfo, se já foi dada, quem joga e
+// a pontuação de cada jogador (a eval da NNUE depende dela).
+
+namespace {
+
+constexpr uint64_t splitmix64(uint64_t& s) {
+    uint64_t z = (s += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+struct ZobristKeys {
+    uint64_t hand[2][NUM_CARDS] = {};
+    uint64_t pile[MAX_PILE][NUM_CARDS] = {};
+    uint64_t trick[4][NUM_CARDS] = {};
+    uint64_t trump[NUM_CARDS] = {};
+    uint64_t score[2][128] = {};
+    uint64_t trumpGiven = 0;
+    uint64_t side = 0;
+
+    constexpr ZobristKeys() {
+        uint64_t s = 0xB15CA4B15CA4ULL;
+        for (auto& row : hand)  for (auto& k : row) k = splitmix64(s);
+        for (auto& row : pile)  for (auto& k : row) k = splitmix64(s);
+        for (auto& row : trick) for (auto& k : row) k = splitmix64(s);
+        for (auto& k : trump) k = splitmix64(s);
+        for (auto& row : score) for (auto& k : row) k = splitmix64(s);
+        trumpGiven = splitmix64(s);
+        side = splitmix64(s);
+    }
+};
+
+constexpr ZobristKeys ZK;
+
+} // namespace
+
 // ======================
 // Métodos de GameState
 // ======================
@@ -133,37 +91,108 @@ void GameState::newGame(RNG& rng) {
     score[0] = 0;
     score[1] = 0;
 
-    hands[0].clear();
-    hands[1].clear();
+    hands[0] = 0;
+    hands[1] = 0;
 
-    trick.cards.clear();
+    trick = Trick{};
     trick.starterPlayer = 0;
 
     currentPlayer = 0;
 
-    // gerar baralho base e baralhar
-    std::vector<Card> fullDeck = makeDeckLocal();
-    shuffleDeckLocal(fullDeck);
+    // gerar baralho base (2,3,4,5,6,10,J,Q,K,A de cada naipe) e baralhar
+    uint8_t fullDeck[NUM_CARDS];
+    for (int i = 0; i < NUM_CARDS; ++i) fullDeck[i] = (uint8_t)i;
+    shuffleDeckLocal(fullDeck, NUM_CARDS);
 
     // última carta vira trunfo
-    trumpCard = fullDeck.back();
-    trumpSuit = trumpCard.suit;
-    fullDeck.pop_back();
+    trumpId = fullDeck[NUM_CARDS - 1];
+
+    // dá 4 cartas alternadas a cada jogador (do topo, como no baralho real)
+    int top = NUM_CARDS - 2;
+    for (int i = 0; i < 4; ++i) {
+        hands[0] |= cardBit(fullDeck[top--]);
+        hands[1] |= cardBit(fullDeck[top--]);
+    }
 
     // o resto fica no deck de compra
-    deck = fullDeck;
+    deckCount = (uint8_t)(top + 1);
+    for (int i = 0; i < deckCount; ++i) pile[i] = fullDeck[i];
 
-    // dá 4 cartas alternadas a cada jogador
-    for (int i = 0; i < 4; ++i) {
-        hands[0].push_back(deck.back()); deck.pop_back();
-        hands[1].push_back(deck.back()); deck.pop_back();
+    refreshHash();
+}
+
+void GameState::randomizeHiddenInfo(int observer, RNG& rng, bool opponentHandKnown) {
+    const int opp = 1 - observer;
+    CardMask known = opponentHandKnown ? hands[opp]
+                                       : (trumpCardGiven ? cardBit(trumpId) : 0) & hands[opp];
+
+    uint8_t unseen[NUM_CARDS];
+    int n = 0;
+    for (CardMask m = (hands[opp] & ~known) | pileMask(); m; )
+        unseen[n++] = (uint8_t)popLsb(m);
+
+    for (int i = n - 1; i > 0; --i) {
+        int j = (int)(rng.nextU64() % (uint64_t)(i + 1));
+        std::swap(unseen[i], unseen[j]);
+    }
+
+    const int oppCount = handSize(opp) - popcount64(known);
+    hands[opp] = known;
+    for (int i = 0; i < oppCount; ++i) hands[opp] |= cardBit(unseen[i]);
+    for (int i = 0; i < deckCount; ++i) pile[i] = unseen[oppCount + i];
+
+    refreshHash();
+}
+
+int GameState::handCardId(int p, int handIndex) const {
+    if (handIndex < 0) return -1;
+    CardMask m = hands[p];
+    for (int i = 0; m; ++i) {
+        int id = popLsb(m);
+        if (i == handIndex) return id;
     }
+    return -1;
+}
+
+int GameState::handIndexOf(int p, int id) const {
+    if (!(hands[p] & cardBit(id))) return -1;
+    return popcount64(hands[p] & (cardBit(id) - 1));
 }
 
-std::vector<int> GameState::getLegalMoves(int p) const {
-    std::vector<int> moves;
+uint64_t GameState::computeHash() const {
+    uint64_t h = ZK.trump[trumpId];
+    for (int p = 0; p < 2; ++p) {
+        for (CardMask m = hands[p]; m; )
+            h ^= ZK.hand[p][popLsb(m)];
+        h ^= ZK.score[p][score[p]];
+    }
+    for (int i = 0; i < deckCount; ++i)
+        h ^= ZK.pile[i][pile[i]];
+    for (int i = 0; i < trick.count; ++i)
+        h ^= ZK.trick[i][trick.cards[i]];
+    if (trumpCardGiven) h ^= ZK.trumpGiven;
+    if (currentPlayer)  h ^= ZK.side;
+    return h;
+}
+
+CardMask GameState::pileMask() const {
+    CardMask m = 0;
+    for (int i = 0; i < deckCount; ++i) m |= cardBit(pile[i]);
+    return m;
+}
+
+void GameState::drawFromPile(int p) {
+    if (deckCount == 0) return;
+    int id = pile[--deckCount];
+    hands[p] |= cardBit(id);
+    hash ^= ZK.pile[deckCount][id] ^ ZK.hand[p][id];
+}
+
+MoveList GameState::getLegalMoves(int p) const {
+    MoveList moves;
     if (p != currentPlayer) return moves;
-    for (int i = 0; i < (int)hands[p].size(); ++i)
+    int n = handSize(p);
+    for (int i = 0; i < n; ++i)
         moves.push_back(i);
     return moves;
 }
@@ -171,106 +200,81 @@ std::vector<int> GameState::getLegalMoves(int p) const {
 bool GameState::playCard(int p, int handIndex) {
     if (finished) return false;
     if (p != currentPlayer) return false;
-    if (handIndex < 0 || handIndex >= (int)hands[p].size()) return false;
 
-    Card c = hands[p][handIndex];
-    hands[p].erase(hands[p].begin() + handIndex);
-    trick.cards.push_back(c);
+    int id = handCardId(p, handIndex);
+    if (id < 0) return false;
+
+    hands[p] &= ~cardBit(id);
+    hash ^= ZK.hand[p][id] ^ ZK.trick[trick.count][id] ^ ZK.side;
+    trick.cards[trick.count++] = (uint8_t)id;
 
-    currentPlayer = 1 - currentPlayer;
+    currentPlayer = (uint8_t)(1 - currentPlayer);
     return true;
 }
 
 // Decide quem ganhou a vaza de 4 cartas e quantos pontos vale
 std::pair<int,int> GameState::evaluateTrick() const {
-    assert(trick.cards.size() == 4);
-
-    int potPoints = 0;
-    for (auto &c : trick.cards)
-        potPoints += cardPointsLocal(c);
-
-    bool anyTrump = false;
-    for (auto &c : trick.cards)
-        if (c.suit == trumpSuit) anyTrump = true;
-
-    int winnerIndex = 0;
-    if (anyTrump) {
-        for (int i = 1; i < 4; ++i) {
-            bool winIsTrump = (trick.cards[winnerIndex].suit == trumpSuit);
-            bool curIsTrump = (trick.cards[i].suit == trumpSuit);
-            if (curIsTrump && !winIsTrump)
-                winnerIndex = i;
-            else if (curIsTrump && winIsTrump &&
-                     cardStrength(trick.cards[i]) > cardStrength(trick.cards[winnerIndex]))
-                winnerIndex = i;
-        }
-    } else {
-        Suit leadSuit = trick.cards[0].suit;
-        for (int i = 1; i < 4; ++i) {
-            bool wFollows = (trick.cards[winnerIndex].suit == leadSuit);
-            bool cFollows = (trick.cards[i].suit == leadSuit);
-            if (cFollows && !wFollows)
-                winnerIndex = i;
-            else if (cFollows && wFollows &&
-                     cardStrength(trick.cards[i]) > cardStrength(trick.cards[winnerIndex]))
-                winnerIndex = i;
-        }
-    }
+    assert(trick.count == 4);
+
+    // vencedor por BEATEN_BY (card.h), pontos por CARD_POINTS
+    const int winnerIndex = trickWinnerIndex(trick.cards, 4, suitOfId(trumpId));
+    const int potPoints = CARD_POINTS[trick.cards[0]] + CARD_POINTS[trick.cards[1]] +
+                          CARD_POINTS[trick.cards[2]] + CARD_POINTS[trick.cards[3]];
 
-    int winnerPlayer = playerOfIndex(trick, winnerIndex);
+    // índices pares são do jogador que abriu a vaza
+    const int winnerPlayer = trick.starterPlayer ^ (winnerIndex & 1);
     return { winnerPlayer, potPoints };
 }
 
 bool GameState::noMoreCardsToDraw() const {
-    return deck.empty() && trumpCardGiven;
+    return deckCount == 0 && trumpCardGiven;
 }
 
 bool GameState::handsAreEmpty() const {
-    return hands[0].empty() && hands[1].empty();
+    return hands[0] == 0 && hands[1] == 0;
 }
 
 void GameState::maybeCloseTrick(RNG& rng) {
-    if (trick.cards.size() < 4) return;
+    if (trick.count < 4) return;
 
     auto [winnerPlayer, potPoints] = evaluateTrick();
+    hash ^= ZK.score[winnerPlayer][score[winnerPlayer]];
     score[winnerPlayer] += potPoints;
+    hash ^= ZK.score[winnerPlayer][score[winnerPlayer]];
     int loserPlayer = 1 - winnerPlayer;
 
-
-    auto drawFromDeck = [&](int plr){
-        if (!deck.empty()) {
-            hands[plr].push_back(deck.back());
-            deck.pop_back();
-        }
-    };
-
     auto needCard = [&](int plr){
-        return ((int)hands[plr].size() < 4) && (!deck.empty() || !trumpCardGiven);
+        return (handSize(plr) < 4) && (deckCount > 0 || !trumpCardGiven);
     };
 
     // comprar do deck (vencedor compra primeiro)
-    if (needCard(winnerPlayer)) drawFromDeck(winnerPlayer);
-    if (needCard(loserPlayer))  drawFromDeck(loserPlayer);
-    if (needCard(winnerPlayer)) drawFromDeck(winnerPlayer);
-    if (needCard(loserPlayer))  drawFromDeck(loserPlayer);
+    if (needCard(winnerPlayer)) drawFromPile(winnerPlayer);
+    if (needCard(loserPlayer))  drawFromPile(loserPlayer);
+    if (needCard(winnerPlayer)) drawFromPile(winnerPlayer);
+    if (needCard(loserPlayer))  drawFromPile(loserPlayer);
 
     // entregar a carta de trunfo virada (a última do baralho)
     // Requisito: vai para quem PERDEU a vaza.
     if (!trumpCardGiven) {
-        if (needCard(loserPlayer)) {
-            hands[loserPlayer].push_back(trumpCard);
-            trumpCardGiven = true;
-        } else if (needCard(winnerPlayer)) {
-            hands[winnerPlayer].push_back(trumpCard);
+        int receiver = needCard(loserPlayer)  ? loserPlayer
+                     : needCard(winnerPlayer) ? winnerPlayer : -1;
+        if (receiver >= 0) {
+            hands[receiver] |= cardBit(trumpId);
             trumpCardGiven = true;
+            hash ^= ZK.hand[receiver][trumpId] ^ ZK.trumpGiven;
         }
     }
 
-    trick.cards.clear();
-    trick.starterPlayer = winnerPlayer;
-    currentPlayer = winnerPlayer;
+    for (int i = 0; i < 4; ++i)
+        hash ^= ZK.trick[i][trick.cards[i]];
+    if (currentPlayer != winnerPlayer)
+        hash ^= ZK.side;
+
+    trick = Trick{};
+    trick.starterPlayer = (uint8_t)winnerPlayer;
+    currentPlayer = (uint8_t)winnerPlayer;
 
-    if (deck.empty() && trumpCardGiven && handsAreEmpty() && trick.cards.empty())
+    if (deckCount == 0 && trumpCardGiven && handsAreEmpty())
         finished = true;
 }
 
@@ -278,30 +282,30 @@ std::string GameState::toString() const {
     std::ostringstream oss;
     oss << "---------------------------------\n";
 
-    oss << "Trunfo: " << cardToString(trumpCard)
-        << " (" << suitName(trumpCard.suit) << ")\n";
+    oss << "Trunfo: " << cardToString(trumpCard())
+        << " (" << suitToString(trumpSuit()) << ")\n";
 
     oss << "Pontuacao: P0=" << score[0]
         << " P1=" << score[1] << "\n";
 
-    oss << "Deck restante: " << deck.size()
+    oss << "Deck restante: " << (int)deckCount
         << " cartas (sem contar trumpCard especial)\n";
     oss << "TrunfoDado: " << (trumpCardGiven ? 1 : 0) << "\n";
 
-    oss << "CurrentPlayer: " << currentPlayer << "\n";
+    oss << "CurrentPlayer: " << (int)currentPlayer << "\n";
 
     oss << "Mao P0:\n";
-    for (size_t i = 0; i < hands[0].size(); ++i)
-        oss << "  [" << i << "] " << cardToString(hands[0][i]) << "\n";
+    for (int i = 0; i < handSize(0); ++i)
+        oss << "  [" << i << "] " << cardToString(handCard(0, i)) << "\n";
 
     oss << "Mao P1:\n";
-    for (size_t i = 0; i < hands[1].size(); ++i)
-        oss << "  [" << i << "] " << cardToString(hands[1][i]) << "\n";
+    for (int i = 0; i < handSize(1); ++i)
+        oss << "  [" << i << "] " << cardToString(handCard(1, i)) << "\n";
 
-    oss << "Trick atual (" << trick.cards.size()
+    oss << "Trick atual (" << trick.size()
         << " cartas jogadas nesta vaza):\n";
-    for (size_t i = 0; i < trick.cards.size(); ++i)
-        oss << "  (" << i << ") " << cardToString(trick.cards[i]) << "\n";
+    for (int i = 0; i < trick.size(); ++i)
+        oss << "  (" << i << ") " << cardToString(trick.card(i)) << "\n";
 
     // (sem imprimir última trick – GUI não depende disso)
 
@@ -1,47 +1,85 @@
 #pragma once
 #include "card.h"
+#include "bitops.h"
 #include "rand.h"
-#include <vector>
 #include <cstdint>
 #include <utility>
 #include <string>
+#include <type_traits>
+
+// Cartas no monte de compra depois de dar 4+4 e separar o trunfo
+constexpr int MAX_PILE = NUM_CARDS - 8 - 1;
+
+// -------------------------------------------------
+// Lista de jogadas sem alocação (uma mão tem no máximo 4 cartas)
+// -------------------------------------------------
+struct MoveList {
+    int moves[4];
+    int count = 0;
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    int operator[](int i) const { return moves[i]; }
+    int& operator[](int i) { return moves[i]; }
+    int front() const { return moves[0]; }
+    int back() const { return moves[count - 1]; }
+    void push_back(int m) { moves[count++] = m; }
+    void pop_back() { --count; }
+    const int* begin() const { return moves; }
+    const int* end() const { return moves + count; }
+    int* begin() { return moves; }
+    int* end() { return moves + count; }
+};
 
-// A vaza atual
+// A vaza atual: cardIds pela ordem em que foram jogados
 struct Trick {
-    // No teu gamestate.cpp atual, trick.cards é std::vector<Card>
-    // e tens trick.starterPlayer.
-    // Vamos alinhar com isso.
-    std::vector<Card> cards;
-    int starterPlayer = 0;
+    uint8_t cards[4] = {0, 0, 0, 0};
+    uint8_t count = 0;
+    uint8_t starterPlayer = 0;
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    Card card(int i) const { return cardFromId(cards[i]); }
+    CardMask mask() const {
+        CardMask m = 0;
+        for (int i = 0; i < count; ++i) m |= cardBit(cards[i]);
+        return m;
+    }
 };
 
+// Estado compacto e trivialmente copiável: copiar um nó da busca é um
+// memcpy de 72 bytes, sem tocar no allocator.
 class GameState {
 public:
-    // Monte de compra. Topo = back()
-    std::vector<Card> deck;
+    // Mãos dos dois jogadores (máscaras por cardId).
+    // A "mão[i]" é a i-ésima carta por ordem crescente de cardId.
+    CardMask hands[2] = {0, 0};
+
+    // Chave Zobrist da posição, mantida incrementalmente por
+    // playCard / maybeCloseTrick (ver computeHash)
+    uint64_t hash = 0;
+
+    // Monte de compra por ordem. Topo = pile[deckCount - 1]
+    uint8_t pile[MAX_PILE] = {};
+    uint8_t deckCount = 0;
+
+    // Estado da vaza atual
+    Trick trick;
 
     // Carta de trunfo (a carta que ficou virada no fim)
-    Card trumpCard;
-    // Naipe de trunfo
-    Suit trumpSuit;
+    uint8_t trumpId = 0;
 
     // Se já demos a carta de trunfo ao comprar depois do deck acabar
     bool trumpCardGiven = false;
 
-    // Mãos dos dois jogadores
-    std::vector<Card> hands[2];
+    // O jogo acabou?
+    bool finished = false;
 
     // Pontuação acumulada
-    int score[2] = {0,0};
+    int16_t score[2] = {0, 0};
 
     // Quem deve jogar agora (0 ou 1)
-    int currentPlayer = 0;
-
-    // Estado da vaza atual
-    Trick trick;
-
-    // O jogo acabou?
-    bool finished = false;
+    uint8_t currentPlayer = 0;
 
     // -------------------------------------------------
     // Inicializa um novo jogo (baralha, dá 4 cartas a cada jogador,
@@ -53,7 +91,7 @@ public:
     // Devolve índices das cartas que o jogador p pode jogar.
     // (No teu jogo podemos jogar qualquer carta da mão.)
     // -------------------------------------------------
-    std::vector<int> getLegalMoves(int p) const;
+    MoveList getLegalMoves(int p) const;
 
     // -------------------------------------------------
     // Joga a carta hands[p][handIndex] para a trick.
@@ -73,6 +111,39 @@ public:
     bool noMoreCardsToDraw() const;
     bool handsAreEmpty() const;
 
+    int handSize(int p) const { return popcount64(hands[p]); }
+    int deckSize() const { return deckCount; }
+
+    // Número de cartas já jogadas neste jogo (ply do jogo, 0..40)
+    int plyCount() const {
+        return NUM_CARDS - handSize(0) - handSize(1) - deckCount - (trumpCardGiven ? 0 : 1);
+    }
+
+    // cardId da carta no índice handIndex da mão de p (-1 se não existir)
+    int handCardId(int p, int handIndex) const;
+    Card handCard(int p, int handIndex) const { return cardFromId(handCardId(p, handIndex)); }
+
+    // índice na mão de p da carta com este cardId (-1 se não a tiver)
+    int handIndexOf(int p, int id) const;
+
+    Card trumpCard() const { return cardFromId(trumpId); }
+    Suit trumpSuit() const { return (Suit)suitOfId(trumpId); }
+
+    // Cartas ainda no monte (sem a carta de trunfo virada)
+    CardMask pileMask() const;
+
+    // Determinização: redistribui ao acaso tudo o que `observer` não vê
+    // (mão do adversário + ordem do monte), mantendo os tamanhos. A carta
+    // de trunfo, se já foi dada ao adversário e ainda não a jogou, fica
+    // com ele (foi vista ao ser entregue). Com opponentHandKnown só
+    // baralha o monte.
+    void randomizeHiddenInfo(int observer, RNG& rng, bool opponentHandKnown = false);
+
+    // Recalcula a chave Zobrist de raiz. Só é preciso quando o estado é
+    // alterado por fora de newGame/playCard/maybeCloseTrick.
+    uint64_t computeHash() const;
+    void refreshHash() { hash = computeHash(); }
+
     // -------------------------------------------------
     // Se a trick tiver 4 cartas:
     //   - atribui pontos ao vencedor
@@ -103,7 +174,10 @@ public:
     //  ---------------------------------
     // -------------------------------------------------
     std::string toString() const;
-    
 
-    
+private:
+    void drawFromPile(int p);
 };
+
+static_assert(std::is_trivially_copyable<GameState>::value,
+              "GameState tem de ser copiável com memcpy");
@@ -9,13 +9,25 @@
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <cmath>
 
 static bool g_rootMTFlag = false;
+static std::string g_searchMode = "ab"; // ab | chance | pimc
+static int g_chanceWidth = 12;
+static int g_pimcSamples = 16;
+static int g_pimcThreads = 0;
+static std::string g_qnnuePath; // rede quantizada (--qnnue)
 
 #include "gamestate.h"
 #include "search.h"
+#include "search_chance.h"
+#include "pimc.h"
 #include "eval_nnue.h"
+#include "eval_cache.h"
+#include "nnue_reload.h"
+#include "nnue_quant.h"
 #include "selfplay.h"
+#include "tablebase.h"
 #include "rand.h"
 
 // ======================================================================
@@ -23,10 +35,14 @@ static bool g_rootMTFlag = false;
 // ======================================================================
 struct EngineContext {
     GameState state;
-    NNUEWeights weights;
+    NNUENetSlot nets; // rede atual; setoption nnue / reloadnet trocam-na a quente
+    uint64_t searchedNetId = 0; // rede da última pesquisa
     int depth = 3;
     bool perfectInfo = false;
     bool rootMT = false;
+    std::string searchMode = "ab";
+    ChanceSearchConfig chanceCfg;
+    PIMCConfig pimcCfg;
     RNG rng;
 
     EngineContext()
@@ -56,6 +72,20 @@ static uint64_t randomSeed() {
     return x;
 }
 
+// Com --qnnue, a avaliação passa a usar a rede quantizada
+static void attachQuantizedNet(NNUEWeights& w) {
+    if (g_qnnuePath.empty()) return;
+    auto q = std::make_shared<QuantizedNNUE>();
+    if (!loadQuantized(*q, g_qnnuePath)) {
+        std::cerr << "Aviso: não consegui carregar a NNUE quantizada de '"
+                  << g_qnnuePath << "'. A usar a rede float.\n";
+        return;
+    }
+    w.quant = q;
+    std::cout << "NNUE quantizada carregada de " << g_qnnuePath
+              << " (kernels " << qnnueKernelName() << ")\n";
+}
+
 // ======================================================================
 // Comando SHOW (engine mode)
 // ======================================================================
@@ -86,13 +116,58 @@ static void cmdPlay(EngineContext& ctx, int idx) {
 // Melhor jogada (engine mode)
 // ======================================================================
 static void cmdBestMove(EngineContext& ctx) {
+    // snapshot da rede: uma troca a meio não afeta esta pesquisa
+    const std::shared_ptr<const NNUEWeights> net = ctx.nets.current();
+    const NNUEWeights& w = *net;
+    // os valores na TT são da rede anterior
+    if (ctx.searchedNetId != 0 && ctx.searchedNetId != w.id) g_TT.clear();
+    ctx.searchedNetId = w.id;
+
     SearchResult r;
-    if (ctx.rootMT) r = searchBestMoveMT(ctx.state, ctx.weights, ctx.depth, ctx.perfectInfo);
-    else            r = searchBestMoveID(ctx.state, ctx.weights, ctx.depth, ctx.perfectInfo);
+    if (ctx.searchMode == "chance")
+        r = searchBestMoveChance(ctx.state, w, ctx.depth, ctx.perfectInfo, ctx.chanceCfg);
+    else if (ctx.searchMode == "pimc")
+        r = searchBestMovePIMC(ctx.state, w, ctx.perfectInfo, ctx.pimcCfg);
+    else if (ctx.rootMT)
+        r = searchBestMoveMT(ctx.state, w, ctx.depth, ctx.perfectInfo);
+    else
+        r = searchBestMoveID(ctx.state, w, ctx.depth, ctx.perfectInfo);
+    if (g_evalCache.enabled()) {
+        std::cout << "info evalcache hits=" << g_evalCache.hits() << "/" << g_evalCache.probes()
+                  << " (" << 100.0 * g_evalCache.hitRate() << "%)\n";
+        g_evalCache.resetStats();
+    }
     std::cout << "bestmove index=" << r.chosenMoveIndex
               << " eval=" << r.eval << "\n";
 }
 
+// ======================================================================
+// Troca de rede (engine mode): "setoption nnue <path>" ou "reloadnet [path]"
+// ======================================================================
+
+// Com --qnnue, o ficheiro quantizado é da rede antiga: a nova é
+// quantizada em memória (na thread de carregamento, sem escrever nada)
+static void quantizeReloadedNet(NNUEWeights& w) {
+    if (g_qnnuePath.empty()) return;
+    auto q = std::make_shared<QuantizedNNUE>();
+    if (quantizeWeights(w, *q)) w.quant = q;
+}
+
+static void cmdLoadNet(EngineContext& ctx, const std::string& path) {
+    if (path.empty()) {
+        std::cout << "Sem caminho de NNUE para carregar.\n";
+    } else if (!ctx.nets.loadAsync(path, quantizeReloadedNet)) {
+        std::cout << "Já há uma NNUE a carregar.\n";
+    } else {
+        std::cout << "info nnue a carregar " << path << "\n";
+    }
+}
+
+static void reportNetStatus(EngineContext& ctx) {
+    std::string msg;
+    if (ctx.nets.takeStatus(msg)) std::cout << msg << "\n";
+}
+
 // ======================================================================
 // Engine loop (modo interativo para GUI)
 // ======================================================================
@@ -101,20 +176,42 @@ static int runEngineMode(const std::string& nnuePath, int depth, bool perfectInf
     ctx.depth = depth;
     ctx.perfectInfo = perfectInfo;
     ctx.rootMT = g_rootMTFlag;
-
-    if (!loadWeights(ctx.weights, nnuePath)) {
+    ctx.searchMode = g_searchMode;
+    ctx.chanceCfg.maxOutcomes = g_chanceWidth;
+    ctx.pimcCfg.samples = g_pimcSamples;
+    ctx.pimcCfg.depth = depth;
+    ctx.pimcCfg.threads = g_pimcThreads;
+
+    auto weights = std::make_shared<NNUEWeights>();
+    if (!loadWeights(*weights, nnuePath)) {
         std::cerr << "Aviso: não consegui carregar NNUE de '" << nnuePath
                   << "'. Usando pesos aleatórios.\n";
-        initRandomWeights(ctx.weights, 178, ctx.rng);
+        initRandomWeights(*weights, 178, ctx.rng);
     } else {
         std::cout << "NNUE carregada de " << nnuePath << "\n";
     }
+    attachQuantizedNet(*weights);
+    ctx.nets.publish(std::move(weights), nnuePath);
 
     std::cout << "Bisca4 Engine pronto.\n";
     std::string line;
     while (true) {
         if (!std::getline(std::cin, line)) break;
+        reportNetStatus(ctx);
         if (line == "quit" || line == "exit") break;
+        else if (line.rfind("setoption", 0) == 0 || line.rfind("reloadnet", 0) == 0) {
+            std::istringstream iss(line);
+            std::string cmd, name, path;
+            iss >> cmd;
+            if (cmd == "setoption") {
+                iss >> name >> path;
+                if (name != "nnue") { std::cout << "Opção desconhecida.\n"; continue; }
+            } else {
+                iss >> path;
+                if (path.empty()) path = ctx.nets.path();
+            }
+            cmdLoadNet(ctx, path);
+        }
         else if (line == "newgame") cmdNewGame(ctx);
         else if (line == "show") cmdShow(ctx.state);
         else if (line == "bestmove") cmdBestMove(ctx);
@@ -150,6 +247,7 @@ static int runSelfPlayMode(const std::string& nnuePath,
         std::cerr << "AVISO: rede carregada tem inputSize="
                   << weights.inputSize << " (esperado 178).\n";
     }
+    attachQuantizedNet(weights);
 
     std::vector<SelfPlaySample> allSamples;
     allSamples.reserve(games * 40);
@@ -211,6 +309,9 @@ static int runSelfPlayMode(const std::string& nnuePath,
     for (auto& th : workers) th.join();
 
     std::cout << "Total samples: " << allSamples.size() << "\n";
+    if (g_evalCache.enabled())
+        std::cout << "Cache de avaliacao: hits=" << g_evalCache.hits() << "/" << g_evalCache.probes()
+                  << " (" << 100.0 * g_evalCache.hitRate() << "%)\n";
 
     // grava dataset com o nome exato pedido (--dataset)
     if (!saveSamples(allSamples, outDataset)) {
@@ -258,6 +359,160 @@ static int runGenWeightsMode(const std::string& outWeights)
     return 0;
 }
 
+// ======================================================================
+// CONVERTNET MODE – regrava uma NNUE (formatos antigos) no formato v2
+// ======================================================================
+static int runConvertNetMode(const std::string& nnuePath, const std::string& outWeights)
+{
+    if (outWeights.empty()) {
+        std::cerr << "Especifique --out-weights para gravar a NNUE.\n";
+        return 1;
+    }
+    NNUEWeights w;
+    if (!loadWeights(w, nnuePath)) {
+        std::cerr << "Falha a carregar NNUE de '" << nnuePath << "'\n";
+        return 1;
+    }
+    if (!saveWeights(w, outWeights)) {
+        std::cerr << "Falha a gravar NNUE em '" << outWeights << "'\n";
+        return 1;
+    }
+    std::cout << "NNUE gravada em '" << outWeights << "' (formato v" << NNUE_FILE_VERSION
+              << ", input=" << w.inputSize << ", h1=" << w.hidden1 << ", h2=" << w.hidden2 << ")\n";
+    return 0;
+}
+
+// ======================================================================
+// QUANTIZE MODE – converte uma NNUE float para int16/int8
+// ======================================================================
+static int runQuantizeMode(const std::string& nnuePath, const std::string& outQnnue)
+{
+    NNUEWeights w;
+    if (!loadWeights(w, nnuePath)) {
+        std::cerr << "Falha a carregar NNUE de '" << nnuePath << "'\n";
+        return 1;
+    }
+    QuantizedNNUE q;
+    if (!quantizeWeights(w, q)) {
+        std::cerr << "Rede '" << nnuePath << "' não suportada pela quantização"
+                  << " (precisa de 178 inputs e h1 <= " << NNUE_MAX_HIDDEN1 << ").\n";
+        return 1;
+    }
+    if (!saveQuantized(q, outQnnue)) {
+        std::cerr << "Falha a gravar NNUE quantizada em '" << outQnnue << "'\n";
+        return 1;
+    }
+    std::cout << "NNUE quantizada gravada em '" << outQnnue << "' (clip1="
+              << q.clip1 << ", clip2=" << q.clip2 << ")\n";
+    return 0;
+}
+
+// ======================================================================
+// EVALCHECK MODE – desvio da rede quantizada face à float em posições de
+// jogos aleatórios (ambas as perspetivas) e velocidade das duas
+// ======================================================================
+static int runEvalCheckMode(const std::string& nnuePath, int games, bool perfectInfo)
+{
+    NNUEWeights w;
+    if (!loadWeights(w, nnuePath)) {
+        std::cerr << "Falha a carregar NNUE de '" << nnuePath << "'\n";
+        return 1;
+    }
+    auto q = std::make_shared<QuantizedNNUE>();
+    if (!g_qnnuePath.empty() ? !loadQuantized(*q, g_qnnuePath) : !quantizeWeights(w, *q)) {
+        std::cerr << "Não foi possível obter a rede quantizada.\n";
+        return 1;
+    }
+    NNUEWeights wq = w;
+    wq.quant = q;
+
+    // posições de jogos aleatórios
+    RNG rng(randomSeed());
+    std::vector<GameState> positions;
+    std::vector<size_t> gameStart; // índice da 1ª posição de cada jogo
+    for (int g = 0; g < games; ++g) {
+        gameStart.push_back(positions.size());
+        GameState st;
+        st.newGame(rng);
+        while (!st.finished) {
+            positions.push_back(st);
+            auto moves = st.getLegalMoves(st.currentPlayer);
+            st.playCard(st.currentPlayer, moves[rng.nextU32() % (uint32_t)moves.size()]);
+            st.maybeCloseTrick(rng);
+        }
+    }
+
+    double sumDev = 0.0, maxDev = 0.0, maxAccDev = 0.0;
+    long n = 0;
+    // o acumulador percorre cada jogo como uma linha da pesquisa (updates
+    // incrementais) e tem de coincidir com a avaliação quantizada completa
+    NNUEAccumulatorStack acc;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        const GameState& st = positions[i];
+        if (std::find(gameStart.begin(), gameStart.end(), i) != gameStart.end())
+            acc.reset(wq, perfectInfo);
+        acc.push(st);
+        for (int p = 0; p < 2; ++p) {
+            const float f = nnueEvaluate(w, st, p, perfectInfo);
+            const float qv = nnueEvaluate(wq, st, p, perfectInfo);
+            const float qa = acc.evaluate(p);
+            const double d = std::fabs((double)f - qv);
+            sumDev += d;
+            maxDev = std::max(maxDev, d);
+            maxAccDev = std::max(maxAccDev, std::fabs((double)qa - qv));
+            ++n;
+        }
+    }
+
+    auto bench = [&](const NNUEWeights& ww) {
+        volatile float sink = 0.0f;
+        auto t0 = std::chrono::steady_clock::now();
+        for (const GameState& st : positions)
+            for (int p = 0; p < 2; ++p) sink = sink + nnueEvaluate(ww, st, p, perfectInfo);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        return secs > 0.0 ? (double)n / secs : 0.0;
+    };
+    const double fps = bench(w);
+    const double qps = bench(wq);
+
+    // mesma rede float, em lotes de NNUE_BATCH posições
+    double bps = 0.0;
+    {
+        std::vector<float> out(positions.size());
+        auto t0 = std::chrono::steady_clock::now();
+        for (int p = 0; p < 2; ++p)
+            nnueEvaluateBatch(w, positions.data(), (int)positions.size(), p, perfectInfo, out.data());
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        bps = secs > 0.0 ? (double)n / secs : 0.0;
+    }
+
+    std::cout << "kernels=" << qnnueKernelName()
+              << " posicoes=" << n
+              << " desvio_medio=" << (n ? sumDev / n : 0.0)
+              << " desvio_max=" << maxDev
+              << " (" << maxDev / g_evalPerPoint << " pontos)"
+              << " acumulador_vs_quant_max=" << maxAccDev << "\n";
+    std::cout << "evals/s float=" << (long)fps << " float_lote=" << (long)bps
+              << " quant=" << (long)qps << "\n";
+    return 0;
+}
+
+// ======================================================================
+// GENTB MODE – gera a tablebase de fim de jogo (duas vazas sem compras)
+// ======================================================================
+static int runGenTBMode(const std::string& outTB, int threads)
+{
+    std::cout << "A gerar tablebase de fim de jogo em '" << outTB << "'...\n";
+    auto t0 = std::chrono::steady_clock::now();
+    if (!generateTablebase(outTB, threads)) {
+        std::cerr << "Falha a gravar tablebase em '" << outTB << "'\n";
+        return 1;
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "Tablebase gravada em '" << outTB << "' (" << secs << "s)\n";
+    return 0;
+}
+
 // ======================================================================
 // MAIN
 // ======================================================================
@@ -270,6 +525,11 @@ int main(int argc, char** argv) {
     int depth = 3;
     bool perfectInfo = false;
     int threads = 0; // 0 -> auto
+    int hashMB = (int)TranspositionTable::DEFAULT_MB;
+    int evalCacheMB = (int)NNUEEvalCache::DEFAULT_MB;
+    std::string tbPath;
+    std::string outTB = "bisca4_endgame.tb";
+    std::string outQnnue = "nnue_quant.bin";
 
     for (int i = 1; i < argc; ++i) {
         std::string a = argv[i];
@@ -286,15 +546,51 @@ int main(int argc, char** argv) {
             threads = std::max(0, std::atoi(argv[++i]));
         } else if (a == "--root-mt") {
             g_rootMTFlag = true;
+        } else if (a == "--search" && i + 1 < argc) {
+            // ab (default), chance (expectimax nas compras) ou pimc (determinizações)
+            g_searchMode = argv[++i];
+        } else if (a == "--chance-width" && i + 1 < argc) {
+            g_chanceWidth = std::max(1, std::atoi(argv[++i]));
+        } else if (a == "--pimc-samples" && i + 1 < argc) {
+            g_pimcSamples = std::max(1, std::atoi(argv[++i]));
+        } else if (a == "--pimc-threads" && i + 1 < argc) {
+            g_pimcThreads = std::max(0, std::atoi(argv[++i]));
+        } else if (a == "--hash" && i + 1 < argc) {
+            hashMB = std::max(1, std::atoi(argv[++i]));
+        } else if (a == "--evalcache" && i + 1 < argc) {
+            evalCacheMB = std::max(0, std::atoi(argv[++i]));
+        } else if (a == "--tb" && i + 1 < argc) {
+            tbPath = argv[++i];
+        } else if (a == "--out-tb" && i + 1 < argc) {
+            outTB = argv[++i];
+        } else if (a == "--qnnue" && i + 1 < argc) {
+            g_qnnuePath = argv[++i];
+        } else if (a == "--out-qnnue" && i + 1 < argc) {
+            outQnnue = argv[++i];
         }
     }
 
+    if (hashMB != (int)g_TT.sizeMB()) g_TT.resize((size_t)hashMB);
+    if (evalCacheMB != (int)g_evalCache.sizeMB()) g_evalCache.resize((size_t)evalCacheMB);
+
+    if (!tbPath.empty() && !loadTablebase(tbPath)) {
+        std::cerr << "Aviso: não consegui carregar a tablebase '" << tbPath << "'.\n";
+    }
+
     if (mode == "engine") {
         return runEngineMode(nnuePath, depth, perfectInfo);
     } else if (mode == "selfplay") {
         return runSelfPlayMode(nnuePath, datasetPath, outWeights, games, depth, threads, perfectInfo);
     } else if (mode == "genweights") {
         return runGenWeightsMode(outWeights);
+    } else if (mode == "convertnet") {
+        return runConvertNetMode(nnuePath, outWeights);
+    } else if (mode == "gentb") {
+        return runGenTBMode(outTB, threads);
+    } else if (mode == "quantize") {
+        return runQuantizeMode(nnuePath, outQnnue);
+    } else if (mode == "evalcheck") {
+        return runEvalCheckMode(nnuePath, games, perfectInfo);
     }
 
     std::cerr << "Modo desconhecido '" << mode << "'.\n";
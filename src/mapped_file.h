@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Ficheiro só de leitura mapeado em memória (mmap / MapViewOfFile).
+// Vários processos que mapeiam o mesmo ficheiro partilham as mesmas
+// páginas da page cache.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return ptr != nullptr; }
+    const uint8_t* data() const { return ptr; }
+    size_t size() const { return len; }
+
+private:
+    const uint8_t* ptr = nullptr;
+    size_t len = 0;
+#if defined(_WIN32)
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+// Grava `data` num ficheiro temporário na mesma pasta e troca-o por `path`
+// com um rename atómico: quem tem `path` mapeado continua a ver o ficheiro
+// antigo (que só desaparece quando o largar) e nunca um meio escrito.
+// No Windows a troca falha enquanto `path` estiver mapeado (devolve false
+// e o ficheiro antigo fica intacto).
+bool writeFileAtomic(const std::string& path, const void* data, size_t size);
@@ -0,0 +1,420 @@
+#include "nnue_quant.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BISCA_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(BISCA_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2  __attribute__((target("avx2")))
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#else
+#define TARGET_AVX2
+#define TARGET_SSE41
+#endif
+
+namespace {
+
+constexpr int QA = 1023;         // valor int16 de uma ativação igual ao clip
+constexpr int QW2 = 8191;        // maior |peso| de cada linha de w2
+constexpr int QW3 = 32767;       // maior |peso| de w3
+constexpr int ACT_SHIFT = 24;    // ponto fixo de act1Mul/act2Mul
+constexpr int ACC_LIMIT = 30000; // margem para o int16 do acumulador
+
+// ======================================================
+// Kernels (escalar / SSE4.1 / AVX2)
+// ======================================================
+
+// acc[i] += col[i] (ou -=), n múltiplo de 32; aritmética modular int16
+void addColumnScalar(int16_t* acc, const int16_t* col, int n, bool sub) {
+    for (int i = 0; i < n; ++i) {
+        uint16_t a = (uint16_t)acc[i], c = (uint16_t)col[i];
+        acc[i] = (int16_t)(uint16_t)(sub ? a - c : a + c);
+    }
+}
+
+// out[r] = sum_i in[i] * w[r*n + i]; com in <= QA, |w| <= QW2 e n <= 256
+// a soma cabe em int32
+void layer2Scalar(const int16_t* in, const int16_t* w, int n, int rows, int32_t* out) {
+    for (int r = 0; r < rows; ++r) {
+        const int16_t* row = w + (size_t)r * n;
+        int32_t s = 0;
+        for (int i = 0; i < n; ++i) s += (int32_t)in[i] * row[i];
+        out[r] = s;
+    }
+}
+
+#if defined(BISCA_X86)
+
+TARGET_SSE41 void addColumnSSE41(int16_t* acc, const int16_t* col, int n, bool sub) {
+    for (int i = 0; i < n; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+        __m128i c = _mm_loadu_si128((const __m128i*)(col + i));
+        a = sub ? _mm_sub_epi16(a, c) : _mm_add_epi16(a, c);
+        _mm_storeu_si128((__m128i*)(acc + i), a);
+    }
+}
+
+TARGET_SSE41 void layer2SSE41(const int16_t* in, const int16_t* w, int n, int rows, int32_t* out) {
+    for (int r = 0; r < rows; ++r) {
+        const int16_t* row = w + (size_t)r * n;
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < n; i += 8) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(in + i));
+            __m128i b = _mm_loadu_si128((const __m128i*)(row + i));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(a, b));
+        }
+        sum = _mm_hadd_epi32(sum, sum);
+        sum = _mm_hadd_epi32(sum, sum);
+        out[r] = _mm_cvtsi128_si32(sum);
+    }
+}
+
+TARGET_AVX2 void addColumnAVX2(int16_t* acc, const int16_t* col, int n, bool sub) {
+    for (int i = 0; i < n; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(acc + i));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(col + i));
+        a = sub ? _mm256_sub_epi16(a, c) : _mm256_add_epi16(a, c);
+        _mm256_storeu_si256((__m256i*)(acc + i), a);
+    }
+}
+
+TARGET_AVX2 void layer2AVX2(const int16_t* in, const int16_t* w, int n, int rows, int32_t* out) {
+    for (int r = 0; r < rows; ++r) {
+        const int16_t* row = w + (size_t)r * n;
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < n; i += 16) {
+            __m256i a = _mm256_loadu_si256((const __m256i*)(in + i));
+            __m256i b = _mm256_loadu_si256((const __m256i*)(row + i));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(a, b));
+        }
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        s = _mm_hadd_epi32(s, s);
+        s = _mm_hadd_epi32(s, s);
+        out[r] = _mm_cvtsi128_si32(s);
+    }
+}
+
+bool cpuHasAVX2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+bool cpuHasSSE41() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 19)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+#endif // BISCA_X86
+
+struct Kernels {
+    void (*addColumn)(int16_t*, const int16_t*, int, bool) = addColumnScalar;
+    void (*layer2)(const int16_t*, const int16_t*, int, int, int32_t*) = layer2Scalar;
+    const char* name = "scalar";
+
+    Kernels() {
+#if defined(BISCA_X86)
+        if (cpuHasAVX2()) {
+            addColumn = addColumnAVX2;
+            layer2 = layer2AVX2;
+            name = "avx2";
+        } else if (cpuHasSSE41()) {
+            addColumn = addColumnSSE41;
+            layer2 = layer2SSE41;
+            name = "sse4.1";
+        }
+#endif
+    }
+};
+
+const Kernels& kernels() {
+    static const Kernels k;
+    return k;
+}
+
+// ======================================================
+// Quantização
+// ======================================================
+
+inline int32_t roundTo(float x, int32_t lo, int32_t hi) {
+    if (!(x > (float)lo)) return lo; // também apanha NaN
+    if (x >= (float)hi) return hi;
+    return (int32_t)std::max<long long>(lo, std::min<long long>(hi, std::llround(x)));
+}
+
+float maxAbs(const NNUEArray& v) {
+    float m = 0.0f;
+    for (float x : v) m = std::max(m, std::fabs(x));
+    return m;
+}
+
+// Máximos de hidden1/hidden2 (pós-ReLU) e do |pré-ativação| de hidden1
+// em posições de jogos aleatórios
+void calibrate(const NNUEWeights& w, int games, float& max1, float& max2, float& maxPre) {
+    max1 = max2 = maxPre = 0.0f;
+    RNG rng(0x5eed5eedULL);
+    std::vector<float> h1(w.hidden1);
+
+    for (int g = 0; g < games; ++g) {
+        GameState st;
+        st.newGame(rng);
+        while (!st.finished) {
+            for (int p = 0; p < 2; ++p) {
+                std::vector<float> in = extractFeatures(st, p, (g & 1) != 0);
+                for (int h = 0; h < w.hidden1; ++h) {
+                    float acc = w.b1[h];
+                    for (int i = 0; i < w.inputSize; ++i) acc += w.w1[h * w.inputSize + i] * in[i];
+                    maxPre = std::max(maxPre, std::fabs(acc));
+                    h1[h] = std::max(acc, 0.0f);
+                    max1 = std::max(max1, h1[h]);
+                }
+                for (int h = 0; h < w.hidden2; ++h) {
+                    float acc = w.b2[h];
+                    for (int i = 0; i < w.hidden1; ++i) acc += w.w2[h * w.hidden1 + i] * h1[i];
+                    max2 = std::max(max2, acc);
+                }
+            }
+            auto moves = st.getLegalMoves(st.currentPlayer);
+            st.playCard(st.currentPlayer, moves[rng.nextU32() % (uint32_t)moves.size()]);
+            st.maybeCloseTrick(rng);
+        }
+    }
+}
+
+constexpr char Q_MAGIC[4] = { 'B', '4', 'Q', 'N' };
+constexpr uint32_t Q_VERSION = 1;
+
+template <class T>
+void writeVec(std::ofstream& f, const std::vector<T>& v) {
+    f.write(reinterpret_cast<const char*>(v.data()), (std::streamsize)(v.size() * sizeof(T)));
+}
+
+template <class T>
+void readVec(std::ifstream& f, std::vector<T>& v, size_t n) {
+    v.resize(n);
+    f.read(reinterpret_cast<char*>(v.data()), (std::streamsize)(n * sizeof(T)));
+}
+
+
+} // namespace
+
+bool quantizeWeights(const NNUEWeights& w, QuantizedNNUE& q, int calibrationGames) {
+    if (w.inputSize != NNUE_INPUT_SIZE || w.hidden2 <= 0 ||
+        w.hidden1 > NNUE_MAX_HIDDEN1 || w.hidden2 > NNUE_MAX_HIDDEN2)
+        return false;
+
+    float max1, max2, maxPre;
+    calibrate(w, std::max(1, calibrationGames), max1, max2, maxPre);
+
+    q.inputSize = w.inputSize;
+    q.hidden1 = w.hidden1;
+    q.hidden2 = w.hidden2;
+    q.hidden1Padded = (w.hidden1 + 31) / 32 * 32;
+    // folga para posições mais extremas do que as da calibração
+    q.clip1 = std::max(max1 * 1.5f, 1e-3f);
+    q.clip2 = std::max(max2 * 1.5f, 1e-3f);
+
+    // 1ª camada: a maior escala em que o acumulador (e os pesos) cabem em int16
+    float w1Max = std::max(maxAbs(w.w1), maxAbs(w.b1));
+    // (folga de 1.5x: o acumulador int16 só tem a parte binária)
+    q.s1 = std::min((float)ACC_LIMIT / std::max(maxPre * 1.5f, 1e-3f),
+                    (float)ACC_LIMIT / std::max(w1Max * 2.0f, 1e-3f));
+    q.act1Mul = roundTo(std::ldexp((float)QA / (q.s1 * q.clip1), ACT_SHIFT), 0, INT32_MAX);
+
+    const int H = q.hidden1Padded;
+    q.w1t.assign((size_t)q.inputSize * H, 0);
+    q.b1.assign(H, 0);
+    for (int i = 0; i < q.inputSize; ++i)
+        for (int h = 0; h < q.hidden1; ++h)
+            q.w1t[(size_t)i * H + h] = (int16_t)roundTo(w.w1[h * w.inputSize + i] * q.s1, -32767, 32767);
+    for (int h = 0; h < q.hidden1; ++h)
+        q.b1[h] = (int16_t)roundTo(w.b1[h] * q.s1, -32767, 32767);
+
+    // hidden2: entrada int16 = x * QA/clip1. Escala por linha: um peso
+    // grande numa linha não tira resolução às outras. (int8 aqui não chega:
+    // as redes treinadas têm linhas de w2 com pesos grandes que se cancelam)
+    q.w2.assign((size_t)q.hidden2 * H, 0);
+    q.b2.assign(q.hidden2, 0);
+    q.act2Mul.assign(q.hidden2, 0);
+    for (int r = 0; r < q.hidden2; ++r) {
+        float rowMax = 1e-6f;
+        for (int i = 0; i < q.hidden1; ++i)
+            rowMax = std::max(rowMax, std::fabs(w.w2[r * w.hidden1 + i]));
+        const float s2 = (float)QW2 / rowMax;
+        for (int i = 0; i < q.hidden1; ++i)
+            q.w2[(size_t)r * H + i] = (int16_t)roundTo(w.w2[r * w.hidden1 + i] * s2, -QW2, QW2);
+        q.b2[r] = roundTo(w.b2[r] * s2 * QA / q.clip1, INT32_MIN / 2, INT32_MAX / 2);
+        q.act2Mul[r] = roundTo(std::ldexp(q.clip1 / (q.clip2 * s2), ACT_SHIFT), 0, INT32_MAX);
+    }
+
+    // saída: entrada int16 = x * QA/clip2
+    const float s3 = (float)QW3 / std::max(maxAbs(w.w3), 1e-6f);
+    q.w3.assign(q.hidden2, 0);
+    for (int i = 0; i < q.hidden2; ++i)
+        q.w3[i] = (int16_t)roundTo(w.w3[i] * s3, -QW3, QW3);
+    q.b3 = roundTo(w.b3 * s3 * QA / q.clip2, INT32_MIN / 2, INT32_MAX / 2);
+    q.outScale = q.clip2 / (s3 * QA);
+    return true;
+}
+
+bool saveQuantized(const QuantizedNNUE& q, const std::string& path) {
+    std::ofstream f(path, std::ios::binary);
+    if (!f) return false;
+    f.write(Q_MAGIC, 4);
+    f.write(reinterpret_cast<const char*>(&Q_VERSION), sizeof(Q_VERSION));
+    const int32_t dims[4] = { q.inputSize, q.hidden1, q.hidden2, q.hidden1Padded };
+    f.write(reinterpret_cast<const char*>(dims), sizeof(dims));
+    const float fl[4] = { q.clip1, q.clip2, q.s1, q.outScale };
+    f.write(reinterpret_cast<const char*>(fl), sizeof(fl));
+    const int32_t ints[2] = { q.act1Mul, q.b3 };
+    f.write(reinterpret_cast<const char*>(ints), sizeof(ints));
+    writeVec(f, q.w1t);
+    writeVec(f, q.b1);
+    writeVec(f, q.w2);
+    writeVec(f, q.b2);
+    writeVec(f, q.act2Mul);
+    writeVec(f, q.w3);
+    return (bool)f;
+}
+
+bool loadQuantized(QuantizedNNUE& q, const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    char magic[4];
+    uint32_t version = 0;
+    f.read(magic, 4);
+    f.read(reinterpret_cast<char*>(&version), sizeof(version));
+    if (!f || std::memcmp(magic, Q_MAGIC, 4) != 0 || version != Q_VERSION) return false;
+
+    int32_t dims[4];
+    float fl[4];
+    int32_t ints[2];
+    f.read(reinterpret_cast<char*>(dims), sizeof(dims));
+    f.read(reinterpret_cast<char*>(fl), sizeof(fl));
+    f.read(reinterpret_cast<char*>(ints), sizeof(ints));
+    if (!f || dims[0] != NNUE_INPUT_SIZE || dims[1] <= 0 || dims[1] > NNUE_MAX_HIDDEN1 ||
+        dims[2] <= 0 || dims[2] > NNUE_MAX_HIDDEN2 || dims[3] != (dims[1] + 31) / 32 * 32)
+        return false;
+
+    q.inputSize = dims[0];
+    q.hidden1 = dims[1];
+    q.hidden2 = dims[2];
+    q.hidden1Padded = dims[3];
+    q.clip1 = fl[0];
+    q.clip2 = fl[1];
+    q.s1 = fl[2];
+    q.outScale = fl[3];
+    q.act1Mul = ints[0];
+    q.b3 = ints[1];
+
+    const size_t H = (size_t)q.hidden1Padded;
+    readVec(f, q.w1t, (size_t)q.inputSize * H);
+    readVec(f, q.b1, H);
+    readVec(f, q.w2, (size_t)q.hidden2 * H);
+    readVec(f, q.b2, (size_t)q.hidden2);
+    readVec(f, q.act2Mul, (size_t)q.hidden2);
+    readVec(f, q.w3, (size_t)q.hidden2);
+    return (bool)f;
+}
+
+// ======================================================
+// Inferência
+// ======================================================
+
+void qnnueRefresh(const QuantizedNNUE& q, const NNUEFeatureState& fs,
+                  int p, bool perfectInfo, int16_t* acc)
+{
+    const Kernels& k = kernels();
+    const int H = q.hidden1Padded;
+    std::copy(q.b1.begin(), q.b1.end(), acc);
+
+    // os escalares (120..122) somam-se só em qnnueOutput
+    NNUESparseFeatures sf;
+    extractSparseFeatures(fs, p, perfectInfo, sf);
+    for (int i = 0; i < sf.count; ++i)
+        k.addColumn(acc, &q.w1t[(size_t)sf.active[i] * H], H, false);
+}
+
+void qnnueUpdate(const QuantizedNNUE& q, const NNUEFeatureState& from,
+                 const NNUEFeatureState& to, int p, bool perfectInfo, int16_t* acc)
+{
+    const Kernels& k = kernels();
+    const int H = q.hidden1Padded;
+    CardMask a[4], b[4];
+    nnueCardBlocks(from, p, perfectInfo, a);
+    nnueCardBlocks(to, p, perfectInfo, b);
+    for (int blk = 0; blk < 4; ++blk) {
+        const int base = NNUE_CARD_BLOCK_BASE[blk];
+        for (CardMask m = b[blk] & ~a[blk]; m; ) k.addColumn(acc, &q.w1t[(size_t)(base + popLsb(m)) * H], H, false);
+        for (CardMask m = a[blk] & ~b[blk]; m; ) k.addColumn(acc, &q.w1t[(size_t)(base + popLsb(m)) * H], H, true);
+    }
+    if (to.trumpCardGiven != from.trumpCardGiven)
+        k.addColumn(acc, &q.w1t[(size_t)167 * H], H, from.trumpCardGiven);
+}
+
+float qnnueOutput(const QuantizedNNUE& q, const int16_t* acc,
+                  const NNUEFeatureState& fs, int p)
+{
+    const int H = q.hidden1Padded;
+    const int16_t* wMe   = &q.w1t[(size_t)120 * H];
+    const int16_t* wOpp  = &q.w1t[(size_t)121 * H];
+    const int16_t* wDeck = &q.w1t[(size_t)122 * H];
+    const int32_t sMe = fs.score[p], sOpp = fs.score[1 - p], deck = fs.deckCount;
+
+    // inputs escalares em ponto fixo: x/120 ~ x*546 >> 16, x/40 ~ x*1638 >> 16
+    alignas(64) int16_t a1[NNUE_MAX_HIDDEN1];
+    for (int h = 0; h < H; ++h) {
+        int64_t v = acc[h] +
+                    (((int64_t)wMe[h] * sMe * 546 + (int64_t)wOpp[h] * sOpp * 546 +
+                      (int64_t)wDeck[h] * deck * 1638 + 32768) >> 16);
+        int64_t a = (std::max<int64_t>(v, 0) * q.act1Mul + (1LL << (ACT_SHIFT - 1))) >> ACT_SHIFT;
+        a1[h] = (int16_t)std::min<int64_t>(a, QA);
+    }
+
+    alignas(64) int32_t z[NNUE_MAX_HIDDEN2];
+    kernels().layer2(a1, q.w2.data(), H, q.hidden2, z);
+
+    int64_t out = q.b3;
+    for (int r = 0; r < q.hidden2; ++r) {
+        int64_t a = (std::max<int64_t>((int64_t)z[r] + q.b2[r], 0) * q.act2Mul[r] +
+                     (1LL << (ACT_SHIFT - 1))) >> ACT_SHIFT;
+        out += q.w3[r] * std::min<int64_t>(a, QA);
+    }
+    return (float)out * q.outScale;
+}
+
+float qnnueEvaluate(const QuantizedNNUE& q, const GameState& st,
+                    int player, bool perfectInfo)
+{
+    alignas(64) int16_t acc[NNUE_MAX_HIDDEN1];
+    NNUEFeatureState fs = NNUEFeatureState::from(st);
+    qnnueRefresh(q, fs, player, perfectInfo, acc);
+    return qnnueOutput(q, acc, fs, player);
+}
+
+const char* qnnueKernelName() {
+    return kernels().name;
+}
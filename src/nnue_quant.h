@@ -0,0 +1,62 @@
+#pragma once
+#include "eval_nnue.h"
+#include <string>
+#include <vector>
+
+// ======================================================
+// NNUE quantizada (inteiros de 16 bits)
+//
+// - 1ª camada: pesos e acumuladores int16 (escala s1). Os inputs
+//   binários entram no acumulador (somas inteiras, exatas e reversíveis);
+//   os 3 inputs escalares (pontuações, monte) somam-se só na avaliação.
+// - clipped ReLU: hidden1 e hidden2 passam a int16 [0..1023], cortando
+//   em clip1/clip2 (máximos medidos numa calibração com jogos aleatórios).
+// - hidden2 e saída: pesos int16 (w2 com uma escala por linha), somas int32.
+//
+// Os kernels do produto 64x32 e das somas de colunas têm versões AVX2,
+// SSE4.1 e escalar, escolhidas em runtime conforme o CPU.
+// ======================================================
+
+struct QuantizedNNUE {
+    int inputSize = 0;
+    int hidden1 = 0;
+    int hidden2 = 0;
+    int hidden1Padded = 0;   // múltiplo de 32 (linhas de w2 e acumuladores)
+
+    float clip1 = 1.0f;      // hidden1 float que corresponde a 1023
+    float clip2 = 1.0f;      // idem para hidden2
+    float s1 = 1.0f;         // escala de w1/b1/acumulador
+    int32_t act1Mul = 0;     // acumulador -> [0..1023] (ponto fixo >>24)
+    float outScale = 1.0f;   // saída int32 -> eval float
+
+    std::vector<int16_t> w1t; // [input][hidden1Padded]
+    std::vector<int16_t> b1;  // [hidden1Padded]
+    std::vector<int16_t> w2;  // [hidden2][hidden1Padded]
+    std::vector<int32_t> b2;  // [hidden2]
+    std::vector<int32_t> act2Mul; // [hidden2] soma -> [0..1023] (>>24, escala por linha de w2)
+    std::vector<int16_t> w3;  // [hidden2]
+    int32_t b3 = 0;
+};
+
+// Quantiza uma rede float (só o layout de 178 inputs com 2 camadas
+// escondidas). Calibra clip1/clip2 em `calibrationGames` jogos aleatórios.
+bool quantizeWeights(const NNUEWeights& w, QuantizedNNUE& q, int calibrationGames = 400);
+
+bool saveQuantized(const QuantizedNNUE& q, const std::string& path);
+bool loadQuantized(QuantizedNNUE& q, const std::string& path);
+
+// Acumulador int16 (bias + inputs binários) de uma perspetiva
+void qnnueRefresh(const QuantizedNNUE& q, const NNUEFeatureState& fs,
+                  int player, bool perfectInfo, int16_t* acc);
+// acc (valor de `from`) passa a ser o de `to`
+void qnnueUpdate(const QuantizedNNUE& q, const NNUEFeatureState& from,
+                 const NNUEFeatureState& to, int player, bool perfectInfo, int16_t* acc);
+// Inputs escalares + camadas seguintes
+float qnnueOutput(const QuantizedNNUE& q, const int16_t* acc,
+                  const NNUEFeatureState& fs, int player);
+
+float qnnueEvaluate(const QuantizedNNUE& q, const GameState& st,
+                    int player, bool perfectInfo);
+
+// "avx2", "sse4.1" ou "scalar"
+const char* qnnueKernelName();
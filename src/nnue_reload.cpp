@@ -0,0 +1,50 @@
+#include "nnue_reload.h"
+
+void NNUENetSlot::publish(std::shared_ptr<const NNUEWeights> w, const std::string& path) {
+    std::atomic_store(&net, std::move(w));
+    std::lock_guard<std::mutex> lk(m);
+    netPath = path;
+}
+
+bool NNUENetSlot::loadAsync(const std::string& path, Prepare prepare) {
+    if (busy.exchange(true, std::memory_order_acq_rel)) return false;
+    if (loader.joinable()) loader.join();
+
+    const bool samePath = path == this->path();
+    loader = std::thread([this, path, samePath, prepare = std::move(prepare)]() {
+        auto w = std::make_shared<NNUEWeights>();
+        std::string msg;
+        if (loadWeights(*w, path)) {
+            if (samePath) detachWeights(*w);
+            if (prepare) prepare(*w);
+            publish(std::move(w), path);
+            msg = "NNUE recarregada de " + path;
+        } else {
+            msg = "Aviso: não consegui carregar NNUE de '" + path + "'. Mantém-se a rede atual.";
+        }
+        {
+            std::lock_guard<std::mutex> lk(m);
+            status = std::move(msg);
+            hasStatus = true;
+        }
+        busy.store(false, std::memory_order_release);
+    });
+    return true;
+}
+
+void NNUENetSlot::wait() {
+    if (loader.joinable()) loader.join();
+}
+
+std::string NNUENetSlot::path() const {
+    std::lock_guard<std::mutex> lk(m);
+    return netPath;
+}
+
+bool NNUENetSlot::takeStatus(std::string& msg) {
+    std::lock_guard<std::mutex> lk(m);
+    if (!hasStatus) return false;
+    msg = std::move(status);
+    hasStatus = false;
+    return true;
+}
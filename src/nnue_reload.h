@@ -0,0 +1,64 @@
+#pragma once
+#include "eval_nnue.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// ======================================================
+// Troca de rede NNUE a quente (engine mode)
+//
+// A rede em uso é um shared_ptr<const NNUEWeights> publicado com
+// std::atomic_store. Cada pesquisa tira um snapshot no início
+// (current()) e usa-o até ao fim; a rede antiga é libertada quando o
+// último snapshot desaparece (estilo RCU). loadAsync carrega e prepara
+// a rede nova numa thread à parte e só a publica se correr bem, por
+// isso o loop do engine continua a responder enquanto isso.
+// A g_evalCache não precisa de ser limpa: a rede nova tem outro id.
+//
+// O ficheiro de uma rede em uso só pode ser substituído com rename
+// (saveWeights, train_nnue.py): a rede mapeada pode ainda estar numa
+// pesquisa. Quem recarrega o mesmo caminho (reloadnet) está a contar que
+// o voltem a escrever, por isso essa rede é copiada para memória própria
+// (detachWeights) em vez de ficar mapeada.
+// ======================================================
+
+class NNUENetSlot {
+public:
+    // Chamado na thread de carregamento, antes de publicar (p.ex. quantizar)
+    using Prepare = std::function<void(NNUEWeights&)>;
+
+    NNUENetSlot() = default;
+    ~NNUENetSlot() { wait(); }
+
+    NNUENetSlot(const NNUENetSlot&) = delete;
+    NNUENetSlot& operator=(const NNUENetSlot&) = delete;
+
+    std::shared_ptr<const NNUEWeights> current() const { return std::atomic_load(&net); }
+    void publish(std::shared_ptr<const NNUEWeights> w, const std::string& path);
+
+    // Começa a carregar `path` em background; false se já há um carregamento
+    bool loadAsync(const std::string& path, Prepare prepare = {});
+    bool loading() const { return busy.load(std::memory_order_acquire); }
+    void wait();
+
+    // Caminho da rede publicada (para o reloadnet)
+    std::string path() const;
+
+    // Resultado do último carregamento acabado, uma só vez (o loop do
+    // engine mostra-o; a thread de carregamento não escreve no stdout)
+    bool takeStatus(std::string& msg);
+
+private:
+    std::shared_ptr<const NNUEWeights> net;
+
+    mutable std::mutex m;
+    std::string netPath;
+    std::string status;
+    bool hasStatus = false;
+
+    std::thread loader;
+    std::atomic<bool> busy{false};
+};
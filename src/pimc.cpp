@@ -0,0 +1,69 @@
+#include "pimc.h"
+
+SearchResult searchBestMovePIMC(const GameState& st,
+                                const NNUEWeights& w,
+                                bool perfectInfo,
+                                const PIMCConfig& cfg)
+{
+    // sem compras as mãos são dedutíveis: nada a amostrar
+    SearchResult egRes;
+    if (endgameRootResult(st, egRes)) return egRes;
+
+    const int p = st.currentPlayer;
+    auto moves = st.getLegalMoves(p);
+    if (moves.empty()) {
+        return SearchResult{ cachedEvaluate(w, st, p, perfectInfo), -1 };
+    }
+
+    g_TT.newSearch();
+
+    const int K = std::max(1, cfg.samples);
+    const int depth = std::max(1, cfg.depth);
+    const uint64_t seed = cfg.seed ? cfg.seed : st.hash;
+
+    int threads = cfg.threads > 0 ? cfg.threads
+                                  : (int)std::thread::hardware_concurrency();
+    threads = std::max(1, std::min(threads, K));
+
+    // score[k * 4 + i] = valor da jogada moves[i] na amostra k (ponto de
+    // vista do root). A mão do root não muda, os índices são os mesmos.
+    std::vector<float> scores((size_t)K * 4, 0.0f);
+    std::atomic<int> next{0};
+
+    auto worker = [&]() {
+        clearMoveOrdering();
+        const float inf = std::numeric_limits<float>::infinity();
+        for (int k = next.fetch_add(1); k < K; k = next.fetch_add(1)) {
+            RNG rng(seed ^ (0x9e3779b97f4a7c15ULL * (uint64_t)(k + 1)));
+            GameState world = st;
+            world.randomizeHiddenInfo(p, rng, perfectInfo);
+
+            for (int i = 0; i < moves.size(); ++i) {
+                GameState ns = applyMove(world, p, moves[i]);
+                scores[(size_t)k * 4 + i] =
+                    searchRecursiveAB(ns, w, p, depth - 1, -inf, inf, perfectInfo);
+            }
+        }
+    };
+
+    if (threads == 1) {
+        worker();
+    } else {
+        std::vector<std::thread> pool;
+        pool.reserve(threads);
+        for (int t = 0; t < threads; ++t) pool.emplace_back(worker);
+        for (auto& th : pool) th.join();
+    }
+
+    SearchResult res{ -std::numeric_limits<float>::infinity(), moves.front() };
+    for (int i = 0; i < moves.size(); ++i) {
+        float sum = 0.0f;
+        for (int k = 0; k < K; ++k) sum += scores[(size_t)k * 4 + i];
+        const float avg = sum / (float)K;
+        if (avg > res.eval) {
+            res.eval = avg;
+            res.chosenMoveIndex = moves[i];
+        }
+    }
+    return res;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "search.h"
+
+// ======================================================
+// PIMC (Perfect Information Monte Carlo)
+//
+// Com informação imperfeita o alpha-beta normal expande a mão real do
+// adversário e a ordem real do monte. Aqui amostramos K mundos
+// consistentes com o que o jogador root vê (GameState::randomizeHiddenInfo),
+// pesquisamos cada um com alpha-beta normal numa worker thread e
+// escolhemos a jogada com melhor score médio entre as amostras.
+// ======================================================
+
+struct PIMCConfig {
+    int samples = 16;  // K determinizações
+    int depth = 5;     // profundidade do alpha-beta em cada amostra
+    int threads = 0;   // 0 -> hardware_concurrency
+    uint64_t seed = 0; // 0 -> derivada do hash da posição
+};
+
+SearchResult searchBestMovePIMC(const GameState& st,
+                                const NNUEWeights& w,
+                                bool perfectInfo,
+                                const PIMCConfig& cfg);
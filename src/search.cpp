@@ -1,57 +1,124 @@
 #include "search.h"
+#include "endgame.h"
 #include <algorithm>
 #include <future>
 #include <numeric>
+#include <type_traits>
 
-// TT storage
-std::unordered_map<uint64_t, TTEntry> g_TT;
-std::mutex g_TTMutex;
-static constexpr size_t MAX_TT_SIZE = 1'000'000; // cap simples para evitar crescer demais
+// ======================================================
+// Move ordering
+//
+// Sem NNUE: TT move primeiro, depois killers e history por
+// (cardId, ply do jogo) e por fim uma heurística estática da vaza.
+// As tabelas são por thread e limpas no início de cada pesquisa.
+// ======================================================
 
-static inline void hashCombine(uint64_t& h, uint64_t v) {
-    h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
-}
+namespace {
+
+constexpr int MAX_GAME_PLY = NUM_CARDS + 1;
+
+struct MoveOrderingTables {
+    int8_t killers[MAX_GAME_PLY][2];
+    int history[NUM_CARDS][MAX_GAME_PLY];
+
+    MoveOrderingTables() { clear(); }
 
-static uint64_t computeHash(const GameState& st) {
-    uint64_t h = 0xCAFEBABE12345678ULL;
-    // current player, scores
-    hashCombine(h, static_cast<uint64_t>(st.currentPlayer));
-    hashCombine(h, static_cast<uint64_t>(st.score[0] & 0xFFFF));
-    hashCombine(h, static_cast<uint64_t>(st.score[1] & 0xFFFF));
-
-    // trump
-    hashCombine(h, static_cast<uint64_t>(static_cast<int>(st.trumpSuit)));
-    hashCombine(h, static_cast<uint64_t>((static_cast<int>(st.trumpCard.suit) << 8) |
-                                        static_cast<int>(st.trumpCard.rank)));
-
-    // deck order
-    for (const auto& c : st.deck) {
-        uint64_t x = (static_cast<uint64_t>(static_cast<int>(c.suit)) << 8) |
-                     static_cast<uint64_t>(static_cast<int>(c.rank));
-        hashCombine(h, x + 0x1111111111111111ULL);
+    void clear() {
+        for (auto& k : killers) { k[0] = -1; k[1] = -1; }
+        for (auto& row : history) for (auto& h : row) h = 0;
     }
+};
+
+thread_local MoveOrderingTables t_order;
+
+// Quem está a ganhar a vaza (parcial) e com que carta
+void partialTrickWinner(const GameState& st, int& winnerPlayer, Card& winnerCard) {
+    const int winnerIndex = trickWinnerIndex(st.trick.cards, st.trick.count, suitOfId(st.trumpId));
+    winnerPlayer = st.trick.starterPlayer ^ (winnerIndex & 1);
+    winnerCard = st.trick.card(winnerIndex);
+}
 
-    // hands
-    for (int p = 0; p < 2; ++p) {
-        for (const auto& c : st.hands[p]) {
-            uint64_t x = (static_cast<uint64_t>(static_cast<int>(c.suit)) << 8) |
-                         static_cast<uint64_t>(static_cast<int>(c.rank));
-            hashCombine(h, x + (p ? 0x2222222222222222ULL : 0));
+// Heurística estática [0..1023]: capturar pontos barato, carregar pontos
+// numa vaza que já é nossa, e não dar pontos nem trunfos à toa.
+int staticMoveScore(const GameState& st, int p, const Card& c) {
+    const bool isTrump = (c.suit == st.trumpSuit());
+    const int pts = cardPoints(c);
+    const int str = cardStrength(c);
+    int score;
+
+    if (st.trick.empty()) {
+        // a abrir: jogar baixo e fora do trunfo
+        score = 500 - pts * 10 - str - (isTrump ? 150 : 0);
+    } else {
+        int winnerPlayer;
+        Card win;
+        partialTrickWinner(st, winnerPlayer, win);
+
+        int tablePts = 0;
+        for (int i = 0; i < st.trick.size(); ++i) tablePts += cardPoints(st.trick.card(i));
+
+        if (winnerPlayer == p) {
+            // vaza nossa: carregar pontos
+            score = 450 + pts * 10 - (isTrump ? 100 : 0);
+        } else {
+            const bool beats = cardBeats(suitOfId(st.trumpId), cardId(win), cardId(c));
+            if (beats)
+                score = 600 + (tablePts + pts) * 8 - (isTrump ? 40 + str * 4 : str);
+            else
+                score = 300 - pts * 10 - str - (isTrump ? 100 : 0);
         }
     }
+    return std::max(0, std::min(1023, score));
+}
+
+} // namespace
+
+int ttBestMove(uint64_t key) {
+    TTEntry e;
+    if (!g_TT.probe(key, e)) return -1;
+    return e.bestMoveHandIdx;
+}
 
-    // trick
-    for (const auto& c : st.trick.cards) {
-        uint64_t x = (static_cast<uint64_t>(static_cast<int>(c.suit)) << 8) |
-                     static_cast<uint64_t>(static_cast<int>(c.rank));
-        hashCombine(h, x + 0x3333333333333333ULL);
+// Ordena `moves` (índices na mão) do mais promissor para o menos
+void orderMoves(const GameState& st, int p, int ttMove, MoveList& moves) {
+    const int ply = st.plyCount();
+    int keys[4];
+    for (int i = 0; i < moves.size(); ++i) {
+        int m = moves[i];
+        int id = st.handCardId(p, m);
+        int tier = 0;
+        if (m == ttMove)                       tier = 3;
+        else if (id == t_order.killers[ply][0]) tier = 2;
+        else if (id == t_order.killers[ply][1]) tier = 1;
+        int hist = std::min(t_order.history[id][ply], (1 << 13) - 1);
+        keys[i] = (tier << 24) | (hist << 10) | staticMoveScore(st, p, cardFromId(id));
     }
-    hashCombine(h, static_cast<uint64_t>(st.trick.starterPlayer));
+    // insertion sort (no máximo 4 jogadas)
+    for (int i = 1; i < moves.size(); ++i) {
+        int k = keys[i], m = moves[i], j = i - 1;
+        while (j >= 0 && keys[j] < k) {
+            keys[j + 1] = keys[j];
+            moves[j + 1] = moves[j];
+            --j;
+        }
+        keys[j + 1] = k;
+        moves[j + 1] = m;
+    }
+}
 
-    // simple flags
-    hashCombine(h, st.finished ? 0xF00DF00DULL : 0x0ULL);
+// Jogada que causou corte: killer + history
+void updateCutoffHeuristics(const GameState& st, int p, int move, int depth) {
+    const int ply = st.plyCount();
+    int id = st.handCardId(p, move);
+    if (t_order.killers[ply][0] != id) {
+        t_order.killers[ply][1] = t_order.killers[ply][0];
+        t_order.killers[ply][0] = (int8_t)id;
+    }
+    t_order.history[id][ply] += depth * depth;
+}
 
-    return h;
+void clearMoveOrdering() {
+    t_order.clear();
 }
 
 GameState applyMove(const GameState& st, int player, int handIndex) {
@@ -68,10 +135,8 @@ bool ttLookup(uint64_t key, int depth,
               float alpha, float beta,
               float& outVal)
 {
-    std::lock_guard<std::mutex> lock(g_TTMutex);
-    auto it = g_TT.find(key);
-    if (it == g_TT.end()) return false;
-    const TTEntry& e = it->second;
+    TTEntry e;
+    if (!g_TT.probe(key, e)) return false;
     if (e.depth < depth) return false;
     switch (e.flag) {
         case TTFlag::EXACT:
@@ -102,11 +167,7 @@ void ttStore(uint64_t key,
     else if (val >= betaOrig) e.flag = TTFlag::LOWERBOUND;
     else e.flag = TTFlag::EXACT;
 
-    std::lock_guard<std::mutex> lock(g_TTMutex);
-    if (g_TT.size() > MAX_TT_SIZE) {
-        g_TT.clear();
-    }
-    g_TT[key] = e;
+    g_TT.store(key, e);
 }
 
 float quiescenceAfterTrickClear(const GameState& st,
@@ -114,44 +175,188 @@ float quiescenceAfterTrickClear(const GameState& st,
                                 int rootPlayer,
                                 bool perfectInfo)
 {
+    if (st.noMoreCardsToDraw())
+        return (float)endgameFinalDiff(st, rootPlayer) * g_evalPerPoint;
+
     // se a vaza acabou de ser limpa (mesa vazia), olha 1 ply
-    if (!st.trick.cards.empty())
-        return nnueEvaluate(w, st, rootPlayer, perfectInfo);
+    if (!st.trick.empty())
+        return cachedEvaluate(w, st, rootPlayer, perfectInfo);
 
     int p = st.currentPlayer;
     auto moves = st.getLegalMoves(p);
     if (moves.empty())
-        return nnueEvaluate(w, st, rootPlayer, perfectInfo);
+        return cachedEvaluate(w, st, rootPlayer, perfectInfo);
+
+    // os irmãos avaliam-se num só lote
+    GameState children[4];
+    float vals[4];
+    const int players[4] = { rootPlayer, rootPlayer, rootPlayer, rootPlayer };
+    for (int i = 0; i < moves.size(); ++i) children[i] = applyMove(st, p, moves[i]);
+    cachedEvaluateBatch(w, children, players, moves.size(), perfectInfo, vals);
+
+    float best = vals[0];
+    for (int i = 1; i < moves.size(); ++i)
+        best = (p == rootPlayer) ? std::max(best, vals[i]) : std::min(best, vals[i]);
+    return best;
+}
 
-    float bestValMax = -std::numeric_limits<float>::infinity();
-    float bestValMin =  std::numeric_limits<float>::infinity();
-    for (int m : moves) {
-        GameState ns = applyMove(st, p, m);
-        float v = nnueEvaluate(w, ns, rootPlayer, perfectInfo);
-        if (p == rootPlayer) bestValMax = std::max(bestValMax, v);
-        else                 bestValMin = std::min(bestValMin, v);
+// ======================================================
+// Negamax com PVS, LMR e futility/razoring
+//
+// Os valores dentro do negamax são do ponto de vista de quem joga;
+// a NNUE continua a avaliar do ponto de vista do rootPlayer e
+// trocamos o sinal. Atenção: depois de fechar a vaza pode jogar
+// outra vez o mesmo jogador, por isso o sinal do filho depende de
+// quem joga a seguir e não apenas da profundidade.
+// ======================================================
+
+namespace {
+
+// Acumuladores NNUE da linha atual (um por ply; ver NNUEAccumulatorStack)
+thread_local NNUEAccumulatorStack t_acc;
+
+struct AccumulatorScope {
+    explicit AccumulatorScope(const GameState& st) { t_acc.push(st); }
+    ~AccumulatorScope() { t_acc.pop(); }
+};
+
+// Avaliação do topo da pilha (st), via g_evalCache
+float evaluateTop(const GameState& st, const NNUEWeights& w, int rootPlayer, bool perfectInfo) {
+    if (!g_evalCache.enabled()) return t_acc.evaluate(rootPlayer);
+    const uint64_t key = NNUEEvalCache::key(st, w, rootPlayer, perfectInfo);
+    float v;
+    if (g_evalCache.probe(key, v)) return v;
+    v = t_acc.evaluate(rootPlayer);
+    g_evalCache.store(key, v);
+    return v;
+}
+
+// quiescenceAfterTrickClear com a NNUE incremental (st já está na pilha)
+float quiescence(const GameState& st, const NNUEWeights& w, int rootPlayer, bool perfectInfo) {
+    if (st.noMoreCardsToDraw())
+        return (float)endgameFinalDiff(st, rootPlayer) * g_evalPerPoint;
+
+    if (!st.trick.empty())
+        return evaluateTop(st, w, rootPlayer, perfectInfo);
+
+    int p = st.currentPlayer;
+    auto moves = st.getLegalMoves(p);
+    if (moves.empty())
+        return evaluateTop(st, w, rootPlayer, perfectInfo);
+
+    // filhos que não estão na cache avaliam-se juntos a partir do topo
+    GameState children[4];
+    float vals[4];
+    uint64_t keys[4];
+    int miss[4], nMiss = 0;
+    const bool useCache = g_evalCache.enabled();
+    for (int i = 0; i < moves.size(); ++i) {
+        GameState child = applyMove(st, p, moves[i]);
+        if (useCache) {
+            keys[i] = NNUEEvalCache::key(child, w, rootPlayer, perfectInfo);
+            if (g_evalCache.probe(keys[i], vals[i])) continue;
+        }
+        children[nMiss] = child;
+        miss[nMiss++] = i;
     }
-    return (p == rootPlayer) ? bestValMax : bestValMin;
+    if (nMiss > 0) {
+        float missVals[4];
+        t_acc.evaluateChildren(children, nMiss, rootPlayer, missVals);
+        for (int j = 0; j < nMiss; ++j) {
+            vals[miss[j]] = missVals[j];
+            if (useCache) g_evalCache.store(keys[miss[j]], missVals[j]);
+        }
+    }
+
+    float best = vals[0];
+    for (int i = 1; i < moves.size(); ++i)
+        best = (p == rootPlayer) ? std::max(best, vals[i]) : std::min(best, vals[i]);
+    return best;
 }
 
-float searchRecursiveAB(const GameState& st,
-                        const NNUEWeights& w,
-                        int rootPlayer,
-                        int depth,
-                        float alpha,
-                        float beta,
-                        bool perfectInfo)
+constexpr float NULL_WINDOW = 1e-4f;
+constexpr int FUTILITY_DEPTH = 2;
+constexpr int LMR_MIN_DEPTH = 3;
+// folga (em pontos de jogo) para o erro da própria NNUE
+constexpr int FUTILITY_SLACK_POINTS = 4;
+
+// máscara das cartas de cada rank (nos 4 naipes)
+constexpr CardMask rankMask(Rank r) {
+    CardMask m = 0;
+    for (int s = 0; s < 4; ++s) m |= 1ULL << (s * 10 + (int)r);
+    return m;
+}
+
+// Máximo de pontos que podem mudar de dono nos próximos d plies:
+// as cartas na mesa mais as d cartas de mais pontos ainda por jogar.
+// Os pontos por ganhar são conhecidos exatamente (120 - score0 - score1).
+int pointSwing(const GameState& st, int d) {
+    int swing = 0;
+    for (int i = 0; i < st.trick.size(); ++i) swing += cardPoints(st.trick.card(i));
+
+    CardMask unplayed = st.hands[0] | st.hands[1] | st.pileMask();
+    if (!st.trumpCardGiven) unplayed |= cardBit(st.trumpId);
+
+    static constexpr Rank byPoints[] = { Rank::A, Rank::R10, Rank::K, Rank::J, Rank::Q };
+    for (Rank r : byPoints) {
+        if (d <= 0) break;
+        int n = std::min(d, popcount64(unplayed & rankMask(r)));
+        swing += n * cardPoints(Card{ Suit::Paus, r });
+        d -= n;
+    }
+    return std::min(swing, 120 - st.score[0] - st.score[1]);
+}
+
+float futilityMargin(const GameState& st, int depth) {
+    return (float)(pointSwing(st, depth) + FUTILITY_SLACK_POINTS) * g_evalPerPoint;
+}
+
+// Descarte "calmo": carta sem pontos, fora do trunfo e que não passa
+// a ganhar a vaza. São estas as jogadas reduzidas/podadas.
+bool isQuietDiscard(const GameState& st, int p, int move) {
+    Card c = st.handCard(p, move);
+    if (cardPoints(c) > 0 || c.suit == st.trumpSuit()) return false;
+    if (st.trick.empty()) return true;
+    int winnerPlayer;
+    Card win;
+    partialTrickWinner(st, winnerPlayer, win);
+    if (winnerPlayer == p) return true;
+    return !cardBeats(suitOfId(st.trumpId), cardId(win), cardId(c));
+}
+
+// Tipo de nó como parâmetro de template: os testes de PV (podas, LMR)
+// resolvem-se em compilação e cada instância fica com o seu código
+enum NodeType { NonPV, PV };
+
+template <NodeType NT>
+float negamax(const GameState& st,
+              const NNUEWeights& w,
+              int rootPlayer,
+              int depth,
+              float alpha,
+              float beta,
+              bool perfectInfo)
 {
+    constexpr bool pvNode = (NT == PV);
+    const int p = st.currentPlayer;
+    const float sign = (p == rootPlayer) ? 1.0f : -1.0f;
+
+    // Sem compras: o resto do jogo resolve-se exatamente, sem NNUE
+    if (st.noMoreCardsToDraw()) {
+        return (float)endgameFinalDiff(st, p) * g_evalPerPoint;
+    }
+
+    AccumulatorScope acc(st);
+
     if (st.finished) {
-        return nnueEvaluate(w, st, rootPlayer, perfectInfo);
+        return sign * evaluateTop(st, w, rootPlayer, perfectInfo);
     }
 
-    float alphaOrig = alpha;
-    float betaOrig = beta;
+    const float alphaOrig = alpha;
+    const uint64_t key = ttSearchKey(st.hash, rootPlayer, perfectInfo);
 
     // TT probe
     if (depth > 0) {
-        uint64_t key = computeHash(st);
         float ttVal;
         if (ttLookup(key, depth, alpha, beta, ttVal)) {
             return ttVal;
@@ -160,75 +365,110 @@ float searchRecursiveAB(const GameState& st,
 
     if (depth == 0) {
         // mini quiescência para posições logo após fechar a vaza
-        return quiescenceAfterTrickClear(st, w, rootPlayer, perfectInfo);
+        return sign * quiescence(st, w, rootPlayer, perfectInfo);
     }
 
-    int p = st.currentPlayer;
     auto moves = st.getLegalMoves(p);
-
     if (moves.empty()) {
-        return nnueEvaluate(w, st, rootPlayer, perfectInfo);
+        return sign * evaluateTop(st, w, rootPlayer, perfectInfo);
     }
 
-    if (p == rootPlayer) {
-        // MAX node
-        float bestVal = -std::numeric_limits<float>::infinity();
-        // move ordering baseado num quickEval do estado seguinte
-        std::vector<std::pair<int,float>> ordered;
-        ordered.reserve(moves.size());
-        for (int m : moves) {
-            GameState ns = applyMove(st, p, m);
-            float ev = quickEval(ns, w, rootPlayer, perfectInfo);
-            ordered.emplace_back(m, ev);
+    // Perto das folhas: reverse futility, razoring e futility pruning,
+    // com margens dadas pelos pontos que ainda podem mudar de dono.
+    bool futilityPrune = false;
+    if (!pvNode && depth <= FUTILITY_DEPTH) {
+        float staticEval = sign * evaluateTop(st, w, rootPlayer, perfectInfo);
+        float margin = futilityMargin(st, depth);
+
+        if (staticEval - margin >= beta)
+            return staticEval;
+
+        if (staticEval + futilityMargin(st, depth + 1) <= alpha) {
+            float q = sign * quiescence(st, w, rootPlayer, perfectInfo);
+            if (q <= alpha) return q;
         }
-        std::sort(ordered.begin(), ordered.end(),
-                  [](const auto& a, const auto& b){ return a.second > b.second; });
 
-        int bestMoveLocal = ordered.empty() ? -1 : ordered.front().first;
-        for (auto [m, _] : ordered) {
-            GameState ns = applyMove(st, p, m);
-            float val = searchRecursiveAB(ns, w, rootPlayer, depth - 1,
-                                          alpha, beta, perfectInfo);
-            if (val > bestVal) bestVal = val;
-            if (val > alpha) {
-                alpha = val;
-                bestMoveLocal = m;
-            }
-            if (alpha >= beta) break; // beta cut
-        }
-        // store TT
-        uint64_t key = computeHash(st);
-        ttStore(key, depth, bestVal, alphaOrig, betaOrig, bestMoveLocal);
-        return bestVal;
-    } else {
-        // MIN node
-        float bestVal = std::numeric_limits<float>::infinity();
-        std::vector<std::pair<int,float>> ordered;
-        ordered.reserve(moves.size());
-        for (int m : moves) {
-            GameState ns = applyMove(st, p, m);
-            float ev = quickEval(ns, w, rootPlayer, perfectInfo);
-            ordered.emplace_back(m, ev);
+        futilityPrune = (staticEval + margin <= alpha);
+    }
+
+    orderMoves(st, p, ttBestMove(key), moves);
+
+    float bestVal = -std::numeric_limits<float>::infinity();
+    int bestMoveLocal = moves.front();
+
+    for (int i = 0; i < moves.size(); ++i) {
+        const int m = moves[i];
+        const bool quiet = isQuietDiscard(st, p, m);
+
+        if (futilityPrune && i > 0 && quiet)
+            continue;
+
+        GameState ns = applyMove(st, p, m);
+        const bool sameSide = (ns.currentPlayer == p);
+        auto searchChild = [&](auto childType, float a, float b, int d) {
+            constexpr NodeType CT = decltype(childType)::value;
+            return sameSide ?  negamax<CT>(ns, w, rootPlayer, d, a, b, perfectInfo)
+                            : -negamax<CT>(ns, w, rootPlayer, d, -b, -a, perfectInfo);
+        };
+        constexpr std::integral_constant<NodeType, NT> sameType{};
+        constexpr std::integral_constant<NodeType, NonPV> nonPV{};
+
+        float val;
+        if (i == 0) {
+            val = searchChild(sameType, alpha, beta, depth - 1);
+        } else {
+            // LMR: descartes calmos tardios com profundidade reduzida
+            int r = (!pvNode && quiet && i >= 2 && depth >= LMR_MIN_DEPTH) ? 1 : 0;
+            val = searchChild(nonPV, alpha, alpha + NULL_WINDOW, depth - 1 - r);
+            if (r > 0 && val > alpha)
+                val = searchChild(nonPV, alpha, alpha + NULL_WINDOW, depth - 1);
+            // PVS: falhou alto na janela nula -> re-search com janela completa
+            if (val > alpha && val < beta)
+                val = searchChild(sameType, alpha, beta, depth - 1);
         }
-        std::sort(ordered.begin(), ordered.end(),
-                  [](const auto& a, const auto& b){ return a.second < b.second; });
 
-        int bestMoveLocal = ordered.empty() ? -1 : ordered.front().first;
-        for (auto [m, _] : ordered) {
-            GameState ns = applyMove(st, p, m);
-            float val = searchRecursiveAB(ns, w, rootPlayer, depth - 1,
-                                          alpha, beta, perfectInfo);
-            if (val < bestVal) bestVal = val;
-            if (val < beta) {
-                beta = val;
-                bestMoveLocal = m;
-            }
-            if (alpha >= beta) break; // alpha cut
+        if (val > bestVal) {
+            bestVal = val;
+            bestMoveLocal = m;
+        }
+        if (val > alpha) alpha = val;
+        if (alpha >= beta) { // corte
+            updateCutoffHeuristics(st, p, m, depth);
+            break;
         }
-        uint64_t key = computeHash(st);
-        ttStore(key, depth, bestVal, alphaOrig, betaOrig, bestMoveLocal);
-        return bestVal;
     }
+
+    // TT guarda valores do ponto de vista de quem joga
+    ttStore(key, depth, bestVal, alphaOrig, beta, bestMoveLocal);
+    return bestVal;
+}
+
+} // namespace
+
+bool endgameRootResult(const GameState& st, SearchResult& res) {
+    if (!st.noMoreCardsToDraw() || st.finished) return false;
+    EndgameResult eg = solveEndgame(st);
+    if (eg.bestMove < 0) return false;
+    int p = st.currentPlayer;
+    res.eval = (float)(st.score[p] - st.score[1 - p] + eg.margin) * g_evalPerPoint;
+    res.chosenMoveIndex = eg.bestMove;
+    return true;
+}
+
+float searchRecursiveAB(const GameState& st,
+                        const NNUEWeights& w,
+                        int rootPlayer,
+                        int depth,
+                        float alpha,
+                        float beta,
+                        bool perfectInfo)
+{
+    t_acc.reset(w, perfectInfo);
+
+    // janela e resultado do ponto de vista do rootPlayer
+    if (st.currentPlayer == rootPlayer)
+        return negamax<PV>(st, w, rootPlayer, depth, alpha, beta, perfectInfo);
+    return -negamax<PV>(st, w, rootPlayer, depth, -beta, -alpha, perfectInfo);
 }
 
 SearchResult searchBestMove(const GameState& st,
@@ -236,6 +476,12 @@ SearchResult searchBestMove(const GameState& st,
                             int depth,
                             bool perfectInfo)
 {
+    SearchResult egRes;
+    if (endgameRootResult(st, egRes)) return egRes;
+
+    g_TT.newSearch();
+    clearMoveOrdering();
+
     SearchResult res;
     res.eval = -std::numeric_limits<float>::infinity();
     res.chosenMoveIndex = -1;
@@ -243,7 +489,7 @@ SearchResult searchBestMove(const GameState& st,
     int p = st.currentPlayer;
     auto moves = st.getLegalMoves(p);
     if (moves.empty()) {
-        res.eval = nnueEvaluate(w, st, p, perfectInfo);
+        res.eval = cachedEvaluate(w, st, p, perfectInfo);
         res.chosenMoveIndex = -1;
         return res;
     }
@@ -286,6 +532,12 @@ SearchResult searchBestMoveMT(const GameState& st,
                               int depth,
                               bool perfectInfo)
 {
+    SearchResult egRes;
+    if (endgameRootResult(st, egRes)) return egRes;
+
+    g_TT.newSearch();
+    clearMoveOrdering();
+
     SearchResult res;
     res.eval = -std::numeric_limits<float>::infinity();
     res.chosenMoveIndex = -1;
@@ -293,7 +545,7 @@ SearchResult searchBestMoveMT(const GameState& st,
     int p = st.currentPlayer;
     auto moves = st.getLegalMoves(p);
     if (moves.empty()) {
-        res.eval = nnueEvaluate(w, st, p, perfectInfo);
+        res.eval = cachedEvaluate(w, st, p, perfectInfo);
         return res;
     }
 
@@ -339,6 +591,12 @@ SearchResult searchBestMoveID(const GameState& st,
                               int depth,
                               bool perfectInfo)
 {
+    SearchResult egRes;
+    if (endgameRootResult(st, egRes)) return egRes;
+
+    g_TT.newSearch();
+    clearMoveOrdering();
+
     // iterative deepening para aquecer TT e refinar ordering
     const int p = st.currentPlayer;
     auto moves = st.getLegalMoves(p);
@@ -346,7 +604,7 @@ SearchResult searchBestMoveID(const GameState& st,
         return searchBestMove(st, w, depth, perfectInfo);
     }
 
-    float bestEval = nnueEvaluate(w, st, p, perfectInfo);
+    float bestEval = cachedEvaluate(w, st, p, perfectInfo);
     int bestMove = moves.front();
 
     float alpha, beta;
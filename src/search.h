@@ -2,15 +2,15 @@
 #include <vector>
 #include <cstdint>
 #include <limits>
-#include <unordered_map>
 #include <atomic>
 #include <thread>
 #include <algorithm>
-#include <mutex>
 
 #include "gamestate.h"
 #include "eval_nnue.h"
+#include "eval_cache.h"
 #include "rand.h"
+#include "tt.h"
 
 // ======================================================
 // SearchResult: resultado de pensar um lance na root
@@ -21,29 +21,6 @@ struct SearchResult {
     int chosenMoveIndex; // índice NA MÃO do jogador root a jogar agora
 };
 
-// ======================================================
-// Transposition Table (TT)
-// Guardamos evals já calculados para (hash, depth)
-// ======================================================
-
-enum class TTFlag : uint8_t {
-    EXACT,
-    LOWERBOUND,
-    UPPERBOUND
-};
-
-struct TTEntry {
-    float value;
-    int depth;
-    TTFlag flag;
-    // também podemos guardar bestMove para move ordering
-    int bestMoveHandIdx;
-};
-
-// TT global simples (podes trocar para array power-of-two depois)
-extern std::unordered_map<uint64_t, TTEntry> g_TT;
-extern std::mutex g_TTMutex;
-
 // ======================================================
 // Funções auxiliares expostas
 // ======================================================
@@ -51,8 +28,15 @@ extern std::mutex g_TTMutex;
 // Aplica jogada e devolve novo estado (cópia + playCard + maybeCloseTrick)
 GameState applyMove(const GameState& st, int player, int handIndex);
 
+// Limpa killers/history da thread atual (feito no início de cada pesquisa)
+void clearMoveOrdering();
+
+// Root já no fim de jogo (sem compras): jogada e valor exatos do solver.
+// Devolve false se a posição ainda tem compras.
+bool endgameRootResult(const GameState& st, SearchResult& res);
+
 // Busca recursiva alpha-beta com:
-// - move ordering
+// - move ordering (TT move, killers, history, heurística da vaza)
 // - quiescence light em depth==0
 // - transposition table
 float searchRecursiveAB(const GameState& st,
@@ -86,13 +70,14 @@ SearchResult searchBestMoveID(const GameState& st,
 // também os usa às vezes
 // ======================================================
 
-// uma avaliação rápida (sem search) usada para ordenar jogadas
+// uma avaliação rápida (sem search) usada para ordenar jogadas; passa
+// pela g_evalCache, porque a root é reordenada a cada iteração e re-search
 inline float quickEval(const GameState& st,
                        const NNUEWeights& w,
                        int rootPlayer,
                        bool perfectInfo)
 {
-    return nnueEvaluate(w, st, rootPlayer, perfectInfo);
+    return cachedEvaluate(w, st, rootPlayer, perfectInfo);
 }
 
 // mini-quiescence "estabilizar depois da vaza"
@@ -115,4 +100,22 @@ void ttStore(uint64_t key,
              float betaOrig,
              int bestMoveHandIdx);
 
+// melhor jogada guardada na TT para `key` (-1 se não houver)
+int ttBestMove(uint64_t key);
+
+// Chave da TT na pesquisa de `rootPlayer`. Sem informação perfeita as
+// folhas avaliam-se com as features escondidas para o root, logo o valor
+// de uma posição depende de quem pesquisa: cada root usa a sua chave.
+inline uint64_t ttSearchKey(uint64_t hash, int rootPlayer, bool perfectInfo) {
+    static constexpr uint64_t ROOT_SALT[2] = { 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL };
+    return perfectInfo ? hash : hash ^ ROOT_SALT[rootPlayer];
+}
+
+// Ordena `moves` (índices na mão) do mais promissor para o menos:
+// TT move, killers, history e heurística estática da vaza
+void orderMoves(const GameState& st, int p, int ttMove, MoveList& moves);
+
+// Jogada que causou corte: atualiza killers + history
+void updateCutoffHeuristics(const GameState& st, int p, int move, int depth);
+
 // ======================================================
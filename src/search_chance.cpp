@@ -0,0 +1,340 @@
+#include "search_chance.h"
+#include "endgame.h"
+#include <algorithm>
+
+namespace {
+
+// As entradas da TT desta pesquisa são valores esperados, não valores
+// com a ordem real do monte: chave separada da pesquisa normal.
+constexpr uint64_t CHANCE_TT_SALT = 0x6a09e667f3bcc909ULL;
+
+constexpr int MAX_OUTCOMES = 64;
+constexpr size_t CHANCE_CACHE_SIZE = 1u << 15;
+
+struct ChanceCacheEntry {
+    uint64_t key;
+    float value;
+};
+
+// Cache dos nós de acaso (valor exato do ponto de vista de quem fechou a vaza)
+thread_local std::vector<ChanceCacheEntry> t_chanceCache;
+
+struct ChanceOutcome {
+    CardMask toWinner;
+    CardMask toLoser;
+};
+
+struct ChanceContext {
+    const NNUEWeights& w;
+    int rootPlayer;
+    bool perfectInfo;
+    int maxOutcomes;
+};
+
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+inline int choose(int n, int k) {
+    if (k < 0 || k > n) return 0;
+    return k == 0 ? 1 : k == 1 ? n : n * (n - 1) / 2;
+}
+
+// i-ésima carta (por id) de m
+inline int nthCard(CardMask m, int i) {
+    while (i-- > 0) m &= m - 1;
+    return lsb64(m);
+}
+
+CardMask pickRandom(CardMask avail, int s, RNG& rng) {
+    CardMask picked = 0;
+    for (int k = 0; k < s; ++k) {
+        int id = nthCard(avail, (int)(rng.nextU32() % (uint32_t)popcount64(avail)));
+        picked |= cardBit(id);
+        avail &= ~cardBit(id);
+    }
+    return picked;
+}
+
+// Mesma sequência de compras que GameState::maybeCloseTrick, só com contagens:
+// devolve quem compra do monte, por ordem (a carta de trunfo é determinística).
+int drawOrder(const GameState& ns, int winner, int order[4]) {
+    int hs[2] = { ns.handSize(0), ns.handSize(1) };
+    int deck = ns.deckCount;
+    const int seq[4] = { winner, 1 - winner, winner, 1 - winner };
+    int n = 0;
+    for (int pl : seq) {
+        if (hs[pl] < 4 && deck > 0) {
+            --deck;
+            ++hs[pl];
+            order[n++] = pl;
+        }
+    }
+    return n;
+}
+
+// Todas as compras possíveis se forem poucas; senão uma amostra fixa
+// (semente = hash da posição, para a TT e a cache serem consistentes)
+int generateOutcomes(CardMask unseen, int nW, int nL, uint64_t seed,
+                     int maxOutcomes, ChanceOutcome* out)
+{
+    const int n = popcount64(unseen);
+    const long total = (long)choose(n, nW) * choose(n - nW, nL);
+    int count = 0;
+    if (total <= maxOutcomes) {
+        forEachSubset(unseen, nW, [&](CardMask a) {
+            forEachSubset(unseen & ~a, nL, [&](CardMask b) {
+                out[count++] = ChanceOutcome{ a, b };
+            });
+        });
+        return count;
+    }
+    RNG rng(seed);
+    for (; count < maxOutcomes; ++count) {
+        CardMask a = pickRandom(unseen, nW, rng);
+        CardMask b = pickRandom(unseen & ~a, nL, rng);
+        out[count] = ChanceOutcome{ a, b };
+    }
+    return count;
+}
+
+// Fecha a vaza de `ns` com uma compra concreta: as cartas sorteadas vão
+// para o topo do monte na ordem das compras e o resto fica ordenado por baixo.
+GameState closeTrickWith(const GameState& ns, const int* order, int nOrder,
+                         int winner, const ChanceOutcome& o)
+{
+    GameState kid = ns;
+    CardMask rest = ns.pileMask() & ~(o.toWinner | o.toLoser);
+    int k = 0;
+    while (rest) kid.pile[k++] = (uint8_t)popLsb(rest);
+
+    CardMask toW = o.toWinner, toL = o.toLoser;
+    for (int j = 0; j < nOrder; ++j) {
+        CardMask& src = (order[j] == winner) ? toW : toL;
+        kid.pile[kid.deckCount - 1 - j] = (uint8_t)popLsb(src);
+    }
+    kid.refreshHash();
+
+    RNG rng(1234);
+    kid.maybeCloseTrick(rng);
+    return kid;
+}
+
+float chanceNegamax(const GameState& st, int depth, float alpha, float beta,
+                    const ChanceContext& c);
+float moveValue(const GameState& st, int p, int m, int depth,
+                float alpha, float beta, const ChanceContext& c);
+
+// Valor de um nó de acaso do ponto de vista de p (quem fechou a vaza).
+// `ns` tem as 4 cartas na mesa e ainda há compras.
+float chanceNode(const GameState& ns, int p, int depth, float alpha, float beta,
+                 const ChanceContext& c)
+{
+    const auto [winner, pts] = ns.evaluateTrick();
+    const CardMask unseen = ns.pileMask();
+
+    int order[4];
+    const int nOrder = drawOrder(ns, winner, order);
+    int nW = 0;
+    for (int j = 0; j < nOrder; ++j) nW += (order[j] == winner);
+
+    // Star1: limites do valor pelos pontos já ganhos e os que faltam
+    const int mine   = ns.score[p]     + (winner == p ? pts : 0);
+    const int theirs = ns.score[1 - p] + (winner == p ? 0 : pts);
+    const int rem = 120 - mine - theirs;
+    const float L = (float)(mine - theirs - rem) * g_evalPerPoint;
+    const float U = (float)(mine - theirs + rem) * g_evalPerPoint;
+
+    const uint64_t cacheKey = mix64(ns.hash ^ mix64(unseen)) ^
+                              (uint64_t)(depth * 2 + c.rootPlayer);
+    ChanceCacheEntry& slot = t_chanceCache[cacheKey & (CHANCE_CACHE_SIZE - 1)];
+    if (slot.key == cacheKey) return slot.value;
+
+    ChanceOutcome outs[MAX_OUTCOMES];
+    const int N = generateOutcomes(unseen, nW, nOrder - nW, ns.hash,
+                                   c.maxOutcomes, outs);
+
+    GameState kids[MAX_OUTCOMES];
+    for (int i = 0; i < N; ++i) kids[i] = closeTrickWith(ns, order, nOrder, winner, outs[i]);
+
+    // todos os filhos têm o vencedor da vaza a jogar
+    auto searchKid = [&](const GameState& kid, float a, float b) {
+        float v = (winner == p) ?  chanceNegamax(kid, depth, a, b, c)
+                                : -chanceNegamax(kid, depth, -b, -a, c);
+        return std::clamp(v, L, U);
+    };
+
+    float lo[MAX_OUTCOMES], hi[MAX_OUTCOMES];
+    for (int i = 0; i < N; ++i) { lo[i] = L; hi[i] = U; }
+
+    // Star2: sondar só a primeira jogada de cada filho. Se o vencedor é p
+    // isso dá um limite inferior de cada filho, senão um limite superior.
+    if (N > 1 && depth > 0) {
+        float sum = 0.0f;
+        for (int i = 0; i < N; ++i) {
+            const GameState& kid = kids[i];
+            const int q = kid.currentPlayer;
+            auto moves = kid.getLegalMoves(q);
+            if (moves.empty()) { sum += (winner == p) ? L : U; continue; }
+            const uint64_t kidKey = ttSearchKey(kid.hash, c.rootPlayer, c.perfectInfo) ^ CHANCE_TT_SALT;
+            orderMoves(kid, q, ttBestMove(kidKey), moves);
+
+            // probe é do ponto de vista de q (= vencedor)
+            const float qL = (q == p) ? L : -U;
+            const float qU = (q == p) ? U : -L;
+            const float probe = moveValue(kid, q, moves.front(), depth - 1, qL, qU, c);
+            if (winner == p) lo[i] = std::clamp(probe, L, U);
+            else             hi[i] = std::clamp(-probe, L, U);
+            sum += (winner == p) ? lo[i] : hi[i];
+        }
+        const float bound = sum / (float)N;
+        if (winner == p && bound >= beta) return bound;
+        if (winner != p && bound <= alpha) return bound;
+    }
+
+    // Star1: janela de cada filho a partir da soma já conhecida e dos
+    // limites dos que faltam
+    float restLo = 0.0f, restHi = 0.0f;
+    for (int i = 0; i < N; ++i) { restLo += lo[i]; restHi += hi[i]; }
+
+    float sum = 0.0f;
+    for (int i = 0; i < N; ++i) {
+        restLo -= lo[i];
+        restHi -= hi[i];
+        const float A = (float)N * alpha - sum - restHi;
+        const float B = (float)N * beta  - sum - restLo;
+
+        if (A >= hi[i]) return (sum + hi[i] + restHi) / (float)N;
+        if (B <= lo[i]) return (sum + lo[i] + restLo) / (float)N;
+
+        // fail-soft pode sair fora de [lo, hi], que já se sabe conter o
+        // valor do filho: sem o clamp a soma deixava de ser exata
+        float v = std::clamp(searchKid(kids[i], std::max(A, lo[i]), std::min(B, hi[i])),
+                             lo[i], hi[i]);
+        if (v <= A) return (sum + v + restHi) / (float)N;
+        if (v >= B) return (sum + v + restLo) / (float)N;
+        sum += v;
+    }
+
+    const float value = sum / (float)N;
+    slot.key = cacheKey;
+    slot.value = value;
+    return value;
+}
+
+// Valor de jogar m do ponto de vista de p (os nós de acaso não gastam depth)
+float moveValue(const GameState& st, int p, int m, int depth,
+                float alpha, float beta, const ChanceContext& c)
+{
+    GameState ns = st;
+    ns.playCard(p, m);
+    if (ns.trick.size() == 4 && ns.deckCount > 0)
+        return chanceNode(ns, p, depth, alpha, beta, c);
+
+    RNG rng(1234);
+    ns.maybeCloseTrick(rng);
+    return (ns.currentPlayer == p) ?  chanceNegamax(ns, depth, alpha, beta, c)
+                                   : -chanceNegamax(ns, depth, -beta, -alpha, c);
+}
+
+// Negamax fail-soft (valor do ponto de vista de quem joga)
+float chanceNegamax(const GameState& st, int depth, float alpha, float beta,
+                    const ChanceContext& c)
+{
+    const int p = st.currentPlayer;
+    const float sign = (p == c.rootPlayer) ? 1.0f : -1.0f;
+
+    if (st.noMoreCardsToDraw())
+        return (float)endgameFinalDiff(st, p) * g_evalPerPoint;
+
+    if (st.finished)
+        return sign * cachedEvaluate(c.w, st, c.rootPlayer, c.perfectInfo);
+
+    const uint64_t key = ttSearchKey(st.hash, c.rootPlayer, c.perfectInfo) ^ CHANCE_TT_SALT;
+    const float alphaOrig = alpha;
+
+    if (depth > 0) {
+        float ttVal;
+        if (ttLookup(key, depth, alpha, beta, ttVal)) return ttVal;
+    }
+
+    if (depth == 0)
+        return sign * quiescenceAfterTrickClear(st, c.w, c.rootPlayer, c.perfectInfo);
+
+    auto moves = st.getLegalMoves(p);
+    if (moves.empty())
+        return sign * cachedEvaluate(c.w, st, c.rootPlayer, c.perfectInfo);
+
+    orderMoves(st, p, ttBestMove(key), moves);
+
+    float bestVal = -std::numeric_limits<float>::infinity();
+    int bestMoveLocal = moves.front();
+    for (int m : moves) {
+        float val = moveValue(st, p, m, depth - 1, alpha, beta, c);
+        if (val > bestVal) {
+            bestVal = val;
+            bestMoveLocal = m;
+        }
+        if (val > alpha) alpha = val;
+        if (alpha >= beta) {
+            updateCutoffHeuristics(st, p, m, depth);
+            break;
+        }
+    }
+
+    ttStore(key, depth, bestVal, alphaOrig, beta, bestMoveLocal);
+    return bestVal;
+}
+
+} // namespace
+
+SearchResult searchBestMoveChance(const GameState& st,
+                                  const NNUEWeights& w,
+                                  int depth,
+                                  bool perfectInfo,
+                                  const ChanceSearchConfig& cfg)
+{
+    SearchResult egRes;
+    if (endgameRootResult(st, egRes)) return egRes;
+
+    g_TT.newSearch();
+    clearMoveOrdering();
+    t_chanceCache.assign(CHANCE_CACHE_SIZE, ChanceCacheEntry{ 0, 0.0f });
+
+    const int p = st.currentPlayer;
+    auto moves = st.getLegalMoves(p);
+    if (moves.empty()) {
+        return SearchResult{ cachedEvaluate(w, st, p, perfectInfo), -1 };
+    }
+
+    // monte em forma canónica: só o conjunto de cartas por ver conta
+    GameState root = st;
+    std::sort(root.pile, root.pile + root.deckCount);
+    root.refreshHash();
+
+    const ChanceContext c{ w, p, perfectInfo,
+                           std::max(1, std::min(cfg.maxOutcomes, MAX_OUTCOMES)) };
+
+    SearchResult res{ -std::numeric_limits<float>::infinity(), moves.front() };
+
+    // iterative deepening: a melhor jogada anterior vai à frente
+    for (int d = 1; d <= std::max(1, depth); ++d) {
+        auto it = std::find(moves.begin(), moves.end(), res.chosenMoveIndex);
+        std::rotate(moves.begin(), it, it + 1);
+
+        float alpha = -std::numeric_limits<float>::infinity();
+        const float beta = std::numeric_limits<float>::infinity();
+        float bestVal = -std::numeric_limits<float>::infinity();
+        int bestMove = moves.front();
+        for (int m : moves) {
+            float v = moveValue(root, p, m, d - 1, alpha, beta, c);
+            if (v > bestVal) { bestVal = v; bestMove = m; }
+            if (bestVal > alpha) alpha = bestVal;
+        }
+        res.eval = bestVal;
+        res.chosenMoveIndex = bestMove;
+    }
+    return res;
+}
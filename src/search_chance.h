@@ -0,0 +1,35 @@
+#pragma once
+#include "search.h"
+
+// ======================================================
+// Pesquisa com nós de acaso nas compras (expectimax *-minimax)
+//
+// O alpha-beta normal compra sempre pile[deckCount-1], ou seja "sabe" a
+// ordem do baralho. Aqui, quando uma jogada fecha uma vaza com compras,
+// o resultado é um nó de acaso: as cartas compradas saem, com
+// probabilidade uniforme, do conjunto de cartas que ninguém viu (o monte).
+// Só interessa o conjunto: o monte é guardado ordenado por id e a ordem
+// real nunca é usada.
+//
+// - Star1: os limites do valor (pontos conhecidos ± pontos por ganhar)
+//   permitem cortar o nó de acaso antes de ver todas as compras.
+// - Star2: antes do Star1, sonda a primeira jogada de cada compra para
+//   obter limites por compra (todos os filhos têm o mesmo jogador a
+//   jogar, o vencedor da vaza).
+// - Cache por (posição antes das compras, conjunto por ver, depth).
+//
+// Com perfectInfo=false a mão do adversário continua a ser a real; a
+// incerteza sobre ela fica para a amostragem de determinizações.
+// ======================================================
+
+struct ChanceSearchConfig {
+    // máximo de compras distintas por nó de acaso; acima disto usa uma
+    // amostra determinística (pesos uniformes)
+    int maxOutcomes = 12;
+};
+
+SearchResult searchBestMoveChance(const GameState& st,
+                                  const NNUEWeights& w,
+                                  int depth,
+                                  bool perfectInfo,
+                                  const ChanceSearchConfig& cfg = ChanceSearchConfig{});
@@ -0,0 +1,422 @@
+#include "tablebase.h"
+#include "endgame.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr char TB_MAGIC[4] = { 'B', '4', 'T', 'B' };
+constexpr uint32_t TB_VERSION = 2;
+constexpr int TB_TRICK_SECTIONS = 4;             // última vaza, cartas na mesa: 0..3
+constexpr int TB_FULL = TB_TRICK_SECTIONS;       // 4+4 no início da penúltima vaza
+constexpr int TB_SECTIONS = TB_TRICK_SECTIONS + 1;
+constexpr CardMask ALL_CARDS = (1ULL << NUM_CARDS) - 1;
+
+struct TBHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t numSections;
+    uint32_t reserved;
+    uint64_t offset[TB_SECTIONS];
+    uint64_t size[TB_SECTIONS];
+};
+
+// Cartas nas mãos com k cartas na mesa (quem abriu joga as posições 0 e 2)
+inline int leaderCards(int k) { return 2 - (k + 1) / 2; }
+inline int otherCards(int k)  { return 2 - k / 2; }
+
+constexpr uint64_t binom(int n, int k) {
+    if (k < 0 || k > n) return 0;
+    uint64_t r = 1;
+    for (int i = 1; i <= k; ++i) r = r * (uint64_t)(n - k + i) / (uint64_t)i;
+    return r;
+}
+
+// Perfect hash: cartas da mesa por ordem (arranjos) e depois cada mão como
+// conjunto (combinações), sempre entre as cartas ainda não usadas.
+struct IndexBuilder {
+    CardMask used = 0;
+    int remaining = NUM_CARDS;
+    uint64_t idx = 0;
+
+    int compress(int id) const { return id - popcount64(used & (cardBit(id) - 1)); }
+
+    void pick(int id) {
+        idx = idx * (uint64_t)remaining + (uint64_t)compress(id);
+        used |= cardBit(id);
+        --remaining;
+    }
+
+    void set(CardMask m, int s) {
+        uint64_t r = 0;
+        int i = 0;
+        for (CardMask x = m; x; ++i) r += binom(compress(popLsb(x)), i + 1);
+        idx = idx * binom(remaining, s) + r;
+        used |= m;
+        remaining -= s;
+    }
+};
+
+uint64_t sectionSize(int k) {
+    uint64_t n = 1;
+    int remaining = NUM_CARDS;
+    for (int i = 0; i < k; ++i) n *= (uint64_t)remaining--;
+    n *= binom(remaining, leaderCards(k));
+    remaining -= leaderCards(k);
+    n *= binom(remaining, otherCards(k));
+    return n;
+}
+
+// Troca o naipe de trunfo com Paus (normalização)
+inline int mapCard(int id, int trump) {
+    int s = suitOfId(id);
+    if (s == trump) s = 0;
+    else if (s == 0) s = trump;
+    return s * 10 + id % 10;
+}
+
+inline CardMask mapMask(CardMask m, int trump) {
+    if (trump == 0) return m;
+    const CardMask block = (1ULL << 10) - 1;
+    CardMask s0 = m & block;
+    CardMask st = (m >> (trump * 10)) & block;
+    m &= ~(block | (block << (trump * 10)));
+    return m | st | (s0 << (trump * 10));
+}
+
+uint64_t positionIndex(const GameState& st, int trump) {
+    const int k = st.trick.count;
+    const int L = st.trick.starterPlayer;
+    IndexBuilder b;
+    for (int i = 0; i < k; ++i) b.pick(mapCard(st.trick.cards[i], trump));
+    b.set(mapMask(st.hands[L], trump), leaderCards(k));
+    b.set(mapMask(st.hands[1 - L], trump), otherCards(k));
+    return b.idx;
+}
+
+// ======================================================
+// Secção 4+4 (logo após a última compra)
+//
+// Além do trunfo, os 3 naipes que não são trunfo são permutáveis: a
+// posição guarda-se uma só vez, com esses naipes ordenados. Cada naipe é
+// um padrão (cartas de quem abre, cartas do outro) de um tipo (i, j) =
+// nº de cartas de cada um; o índice é o offset da configuração (tipo do
+// trunfo + multiconjunto de tipos dos outros naipes), depois o rank do
+// padrão do trunfo e, por grupo de naipes do mesmo tipo, o rank do
+// multiconjunto dos seus padrões. ~9.1e8 entradas em vez de ~5.4e9.
+// ======================================================
+
+constexpr int HAND = 4;
+constexpr int KINDS = (HAND + 1) * (HAND + 1); // tipo = i * 5 + j
+constexpr uint64_t NO_CONFIG = ~0ULL;
+constexpr uint32_t SUIT_BITS = (1u << 10) - 1;
+
+inline int kindOf(int i, int j) { return i * (HAND + 1) + j; }
+
+inline uint64_t patternCount(int kind) {
+    const int i = kind / (HAND + 1), j = kind % (HAND + 1);
+    return binom(10, i) * binom(10 - i, j);
+}
+
+// Rank colex de um conjunto de bits
+inline uint64_t rankSet(uint32_t m) {
+    uint64_t r = 0;
+    for (int n = 0; m; ++n) {
+        const int b = lsb64(m);
+        m &= m - 1;
+        r += binom(b, n + 1);
+    }
+    return r;
+}
+
+// Rank do padrão (a, b) de um naipe dentro do seu tipo; b conta só entre
+// as cartas que a não tem
+inline uint64_t patternRank(uint32_t a, uint32_t b) {
+    uint32_t bc = 0;
+    int pos = 0;
+    for (int c = 0; c < 10; ++c) {
+        if (a & (1u << c)) continue;
+        if (b & (1u << c)) bc |= 1u << pos;
+        ++pos;
+    }
+    const int i = popcount64(a), j = popcount64(b);
+    return rankSet(a) * binom(10 - i, j) + rankSet(bc);
+}
+
+inline int configKey(int t, int k1, int k2, int k3) {
+    return ((t * KINDS + k1) * KINDS + k2) * KINDS + k3;
+}
+
+struct FullLayout {
+    std::vector<uint64_t> offset; // por configKey (k1 <= k2 <= k3)
+    uint64_t size = 0;
+
+    FullLayout() : offset((size_t)KINDS * KINDS * KINDS * KINDS, NO_CONFIG) {
+        forEachConfig([&](int t, int k1, int k2, int k3) {
+            offset[configKey(t, k1, k2, k3)] = size;
+            size += configSize(t, k1, k2, k3);
+        });
+    }
+
+    // Configurações válidas (4 cartas de cada lado), por ordem do ficheiro
+    template <class F>
+    static void forEachConfig(F&& f) {
+        for (int t = 0; t < KINDS; ++t)
+            for (int k1 = 0; k1 < KINDS; ++k1)
+                for (int k2 = k1; k2 < KINDS; ++k2)
+                    for (int k3 = k2; k3 < KINDS; ++k3) {
+                        const int ks[4] = { t, k1, k2, k3 };
+                        int si = 0, sj = 0;
+                        for (int k : ks) {
+                            si += k / (HAND + 1);
+                            sj += k % (HAND + 1);
+                        }
+                        if (si == HAND && sj == HAND) f(t, k1, k2, k3);
+                    }
+    }
+
+    // Padrões de cada grupo de naipes iguais: multiconjuntos
+    static uint64_t groupRadix(int kind, int g) {
+        return binom((int)patternCount(kind) + g - 1, g);
+    }
+
+    static uint64_t configSize(int t, int k1, int k2, int k3) {
+        uint64_t n = patternCount(t);
+        const int ks[3] = { k1, k2, k3 };
+        for (int s = 0; s < 3; ) {
+            int e = s;
+            while (e < 3 && ks[e] == ks[s]) ++e;
+            n *= groupRadix(ks[s], e - s);
+            s = e;
+        }
+        return n;
+    }
+};
+
+const FullLayout& fullLayout() {
+    static const FullLayout layout;
+    return layout;
+}
+
+// Índice na secção 4+4; as mãos já com o trunfo em Paus
+uint64_t fullIndex(CardMask leader, CardMask other) {
+    struct Pat { int kind; uint64_t rank; };
+    Pat p[4];
+    for (int s = 0; s < 4; ++s) {
+        const uint32_t a = (uint32_t)(leader >> (10 * s)) & SUIT_BITS;
+        const uint32_t b = (uint32_t)(other >> (10 * s)) & SUIT_BITS;
+        p[s] = { kindOf(popcount64(a), popcount64(b)), patternRank(a, b) };
+    }
+    std::sort(p + 1, p + 4, [](const Pat& x, const Pat& y) {
+        return x.kind != y.kind ? x.kind < y.kind : x.rank < y.rank;
+    });
+
+    const FullLayout& lay = fullLayout();
+    uint64_t idx = p[0].rank;
+    for (int s = 1; s < 4; ) {
+        int e = s;
+        while (e < 4 && p[e].kind == p[s].kind) ++e;
+        // rank de multiconjunto: soma de C(r_m + m - 1, m)
+        uint64_t r = 0;
+        for (int m = s; m < e; ++m) r += binom((int)p[m].rank + (m - s), m - s + 1);
+        idx = idx * FullLayout::groupRadix(p[s].kind, e - s) + r;
+        s = e;
+    }
+    return lay.offset[configKey(p[0].kind, p[1].kind, p[2].kind, p[3].kind)] + idx;
+}
+
+// Todos os padrões (a, b) de um tipo, por rank
+std::vector<std::pair<uint32_t, uint32_t>> patternsOf(int kind) {
+    const int i = kind / (HAND + 1), j = kind % (HAND + 1);
+    std::vector<std::pair<uint32_t, uint32_t>> out(patternCount(kind));
+    for (uint32_t a = 0; a <= SUIT_BITS; ++a) {
+        if (popcount64(a) != i) continue;
+        for (uint32_t b = 0; b <= SUIT_BITS; ++b) {
+            if ((a & b) || popcount64(b) != j) continue;
+            out[patternRank(a, b)] = { a, b };
+        }
+    }
+    return out;
+}
+
+void generateFullSection(std::vector<int8_t>& data, int threads) {
+    std::vector<std::pair<uint32_t, uint32_t>> pats[KINDS];
+    for (int k = 0; k < KINDS; ++k) pats[k] = patternsOf(k);
+
+    // uma tarefa por (configuração, padrão do trunfo)
+    struct Task { int t, k1, k2, k3; uint32_t trumpRank; };
+    std::vector<Task> tasks;
+    FullLayout::forEachConfig([&](int t, int k1, int k2, int k3) {
+        for (uint32_t r = 0; r < pats[t].size(); ++r) tasks.push_back({ t, k1, k2, k3, r });
+    });
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        GameState st;
+        st.deckCount = 0;
+        st.trumpId = 0;          // só o naipe de trunfo (Paus) interessa
+        st.trumpCardGiven = true;
+        st.trick.count = 0;
+        st.trick.starterPlayer = 0;
+        st.currentPlayer = 0;
+
+        for (size_t n; (n = next.fetch_add(1, std::memory_order_relaxed)) < tasks.size(); ) {
+            const Task& tk = tasks[n];
+            const auto& p1 = pats[tk.k1];
+            const auto& p2 = pats[tk.k2];
+            const auto& p3 = pats[tk.k3];
+            const auto tp = pats[tk.t][tk.trumpRank];
+            // naipes do mesmo tipo por ordem de rank: cada posição uma vez
+            for (size_t r1 = 0; r1 < p1.size(); ++r1)
+                for (size_t r2 = tk.k2 == tk.k1 ? r1 : 0; r2 < p2.size(); ++r2)
+                    for (size_t r3 = tk.k3 == tk.k2 ? r2 : 0; r3 < p3.size(); ++r3) {
+                        st.hands[0] = (CardMask)tp.first | ((CardMask)p1[r1].first << 10) |
+                                      ((CardMask)p2[r2].first << 20) | ((CardMask)p3[r3].first << 30);
+                        st.hands[1] = (CardMask)tp.second | ((CardMask)p1[r1].second << 10) |
+                                      ((CardMask)p2[r2].second << 20) | ((CardMask)p3[r3].second << 30);
+                        st.refreshHash();
+                        data[fullIndex(st.hands[0], st.hands[1])] = (int8_t)solveEndgame(st).margin;
+                    }
+        }
+    };
+
+    if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; ++i) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
+}
+
+struct LoadedTB {
+    MappedFile file;
+    const int8_t* section[TB_SECTIONS] = {};
+    uint64_t size[TB_SECTIONS] = {};
+    bool loaded = false;
+};
+
+LoadedTB g_tb;
+
+} // namespace
+
+bool generateTablebase(const std::string& path, int threads) {
+    TBHeader h;
+    std::memcpy(h.magic, TB_MAGIC, 4);
+    h.version = TB_VERSION;
+    h.numSections = TB_SECTIONS;
+    h.reserved = 0;
+    uint64_t off = sizeof(TBHeader);
+    for (int k = 0; k < TB_SECTIONS; ++k) {
+        h.offset[k] = off;
+        h.size[k] = k == TB_FULL ? fullLayout().size : sectionSize(k);
+        off += h.size[k];
+    }
+
+    std::ofstream f(path, std::ios::binary);
+    if (!f) return false;
+    f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+    // as secções da última vaza primeiro: a 4+4 já as consulta
+    for (int k = 0; k < TB_TRICK_SECTIONS; ++k) {
+        std::vector<int8_t> data(h.size[k], 0);
+
+        GameState st;
+        st.deckCount = 0;
+        st.trumpId = 0;          // só o naipe de trunfo (Paus) interessa
+        st.trumpCardGiven = true;
+        st.trick.count = (uint8_t)k;
+        st.trick.starterPlayer = 0;
+        st.currentPlayer = (uint8_t)(k % 2);
+
+        // cartas da mesa por ordem (faltam `left`), depois as duas mãos
+        auto enumerate = [&](auto&& self, int left, CardMask used) -> void {
+            if (left > 0) {
+                for (CardMask a = ALL_CARDS & ~used; a; ) {
+                    int id = popLsb(a);
+                    st.trick.cards[popcount64(used)] = (uint8_t)id;
+                    self(self, left - 1, used | cardBit(id));
+                }
+                return;
+            }
+            forEachSubset(ALL_CARDS & ~used, leaderCards(k), [&](CardMask lh) {
+                forEachSubset(ALL_CARDS & ~(used | lh), otherCards(k), [&](CardMask oh) {
+                    st.hands[0] = lh;
+                    st.hands[1] = oh;
+                    st.refreshHash();
+                    data[positionIndex(st, 0)] = (int8_t)solveEndgame(st).margin;
+                });
+            });
+        };
+        enumerate(enumerate, k, 0);
+
+        f.write(reinterpret_cast<const char*>(data.data()), (std::streamsize)data.size());
+    }
+    if (!f) return false;
+    f.flush();
+
+    // o solver da secção 4+4 usa a última vaza já gravada
+    if (!loadTablebase(path, TB_TRICK_SECTIONS)) return false;
+    std::vector<int8_t> full(h.size[TB_FULL], 0);
+    generateFullSection(full, threads);
+    f.write(reinterpret_cast<const char*>(full.data()), (std::streamsize)full.size());
+    f.close();
+    return (bool)f && loadTablebase(path);
+}
+
+bool loadTablebase(const std::string& path, int sections) {
+    g_tb.loaded = false;
+    g_tb.file.close();
+    if (!g_tb.file.open(path)) return false;
+    if (g_tb.file.size() < sizeof(TBHeader)) return false;
+
+    TBHeader h;
+    std::memcpy(&h, g_tb.file.data(), sizeof(h));
+    if (std::memcmp(h.magic, TB_MAGIC, 4) != 0 || h.version != TB_VERSION ||
+        h.numSections != TB_SECTIONS)
+        return false;
+
+    sections = std::min(sections, TB_SECTIONS);
+    for (int k = 0; k < TB_SECTIONS; ++k) {
+        g_tb.section[k] = nullptr;
+        g_tb.size[k] = 0;
+        if (k >= sections) continue;
+        const uint64_t want = k == TB_FULL ? fullLayout().size : sectionSize(k);
+        if (h.size[k] != want || h.offset[k] + h.size[k] > g_tb.file.size())
+            return false;
+        g_tb.section[k] = reinterpret_cast<const int8_t*>(g_tb.file.data() + h.offset[k]);
+        g_tb.size[k] = h.size[k];
+    }
+    g_tb.loaded = true;
+    return true;
+}
+
+bool tablebaseLoaded() {
+    return g_tb.loaded;
+}
+
+bool probeTablebase(const GameState& st, int& margin) {
+    if (!g_tb.loaded || st.finished || !st.noMoreCardsToDraw()) return false;
+
+    const int k = st.trick.count;
+    const int L = st.trick.starterPlayer;
+    const int trump = (int)st.trumpSuit();
+
+    // início da penúltima vaza: 4+4 com a mesa vazia
+    if (k == 0 && st.handSize(L) == HAND && st.handSize(1 - L) == HAND) {
+        if (!g_tb.section[TB_FULL]) return false;
+        margin = g_tb.section[TB_FULL][fullIndex(mapMask(st.hands[L], trump),
+                                                 mapMask(st.hands[1 - L], trump))];
+        return true;
+    }
+
+    if (k >= TB_TRICK_SECTIONS) return false;
+    if (st.handSize(L) != leaderCards(k) || st.handSize(1 - L) != otherCards(k))
+        return false;
+
+    margin = g_tb.section[k][positionIndex(st, trump)];
+    return true;
+}
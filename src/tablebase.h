@@ -0,0 +1,37 @@
+#pragma once
+#include "gamestate.h"
+#include <string>
+
+// ======================================================
+// Tablebase de fim de jogo (ficheiro .tb mapeado em memória)
+//
+// Guarda a margem exata que falta (pontos de quem joga menos os do
+// adversário) das posições sem compras em que o solver mais cai:
+//  - última vaza: 2+2 cartas com a mesa vazia e as 3 fases da vaza a meio
+//    (1+2 / 1+1 / 0+1 cartas nas mãos com 1..3 cartas na mesa);
+//  - penúltima vaza: 4+4 com a mesa vazia, a posição logo após a última
+//    compra, onde a pesquisa e os rollouts do MCTS chamam o solver.
+// Os naipes são normalizados para o trunfo ser sempre Paus e o índice é
+// um perfect hash combinatório (cartas da mesa por ordem, depois a mão
+// de quem abriu e a do outro como conjuntos), por isso cada consulta é O(1).
+// Na secção 4+4 os 3 naipes que não são trunfo também se ordenam (são
+// permutáveis), o que a reduz de ~5.4e9 para ~9.1e8 entradas (~0.9 GB).
+//
+// A penúltima vaza a meio (3+4, 3+3, 2+3 com cartas na mesa) não está na
+// tablebase (~1e11 posições): o solver joga essa vaza e consulta a última.
+// ======================================================
+
+// Gera a tablebase completa em `path` (usa solveEndgame; a secção 4+4 com
+// `threads` threads, 0 = todas). Devolve false se não conseguir escrever
+// o ficheiro. No fim a tablebase fica carregada.
+bool generateTablebase(const std::string& path, int threads = 0);
+
+// Carrega (mmap) a tablebase global, só as primeiras `sections` secções
+// (a geração usa a última vaza antes de a 4+4 existir). Chamadas
+// seguintes substituem a anterior.
+bool loadTablebase(const std::string& path, int sections = 5);
+bool tablebaseLoaded();
+
+// Consulta O(1). Devolve true e a margem de currentPlayer se a posição
+// estiver coberta e a tablebase carregada.
+bool probeTablebase(const GameState& st, int& margin);
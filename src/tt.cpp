@@ -0,0 +1,121 @@
+#include "tt.h"
+#include <cstring>
+
+TranspositionTable g_TT;
+
+// Layout de `data` (64 bits):
+//   [ 0..31] value (bits do float)
+//   [32..39] depth + 1 (0 = entrada vazia)
+//   [40..41] flag
+//   [42..47] bestMove + 1 (0 = nenhum)
+//   [48..55] geração
+namespace {
+
+uint64_t packData(const TTEntry& e, uint8_t gen) {
+    uint32_t vbits;
+    std::memcpy(&vbits, &e.value, sizeof(vbits));
+    int d = e.depth + 1;
+    if (d < 1) d = 1;
+    if (d > 255) d = 255;
+    int mv = e.bestMoveHandIdx + 1;
+    if (mv < 0 || mv > 63) mv = 0;
+    return (uint64_t)vbits
+         | ((uint64_t)d << 32)
+         | ((uint64_t)e.flag << 40)
+         | ((uint64_t)mv << 42)
+         | ((uint64_t)gen << 48);
+}
+
+TTEntry unpackData(uint64_t data) {
+    TTEntry e;
+    uint32_t vbits = (uint32_t)data;
+    std::memcpy(&e.value, &vbits, sizeof(vbits));
+    e.depth = (int)((data >> 32) & 0xFF) - 1;
+    e.flag = (TTFlag)((data >> 40) & 0x3);
+    e.bestMoveHandIdx = (int)((data >> 42) & 0x3F) - 1;
+    return e;
+}
+
+inline int dataDepth(uint64_t data) { return (int)((data >> 32) & 0xFF) - 1; }
+inline uint8_t dataGen(uint64_t data) { return (uint8_t)(data >> 48); }
+
+} // namespace
+
+void TranspositionTable::resize(size_t mb) {
+    if (mb < 1) mb = 1;
+    size_t want = (mb << 20) / sizeof(Bucket);
+    size_t n = 1;
+    while (n * 2 <= want) n *= 2;
+
+    buckets.reset(new Bucket[n]);
+    bucketCount = n;
+    generation.store(0, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+    for (size_t i = 0; i < bucketCount; ++i) {
+        for (auto& s : buckets[i].slots) {
+            s.keyXorData.store(0, std::memory_order_relaxed);
+            s.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    generation.store(0, std::memory_order_relaxed);
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry& out) const {
+    const Bucket& b = buckets[key & (bucketCount - 1)];
+    for (const auto& s : b.slots) {
+        uint64_t data = s.data.load(std::memory_order_relaxed);
+        uint64_t kx   = s.keyXorData.load(std::memory_order_relaxed);
+        if (data != 0 && (kx ^ data) == key) {
+            out = unpackData(data);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, const TTEntry& e) {
+    Bucket& b = buckets[key & (bucketCount - 1)];
+    const uint8_t gen = generation.load(std::memory_order_relaxed);
+
+    // 1) mesma posição: substitui, a não ser que a entrada atual seja
+    //    desta pesquisa e bastante mais profunda
+    // 2) senão, vítima = menor (depth - 8 * idade); vazias primeiro
+    Slot* victim = nullptr;
+    int victimScore = 1 << 30;
+    for (auto& s : b.slots) {
+        uint64_t data = s.data.load(std::memory_order_relaxed);
+        uint64_t kx   = s.keyXorData.load(std::memory_order_relaxed);
+        if (data == 0) {
+            if (victimScore > -1000) { victim = &s; victimScore = -1000; }
+            continue;
+        }
+        if ((kx ^ data) == key) {
+            if (dataGen(data) == gen && dataDepth(data) > e.depth + 2 &&
+                e.flag != TTFlag::EXACT)
+                return;
+            victim = &s;
+            break;
+        }
+        int age = (uint8_t)(gen - dataGen(data));
+        int score = dataDepth(data) - 8 * age;
+        if (score < victimScore) { victim = &s; victimScore = score; }
+    }
+
+    uint64_t data = packData(e, gen);
+    victim->data.store(data, std::memory_order_relaxed);
+    victim->keyXorData.store(key ^ data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const {
+    const uint8_t gen = generation.load(std::memory_order_relaxed);
+    size_t n = bucketCount < 250 ? bucketCount : 250;
+    int used = 0;
+    for (size_t i = 0; i < n; ++i)
+        for (const auto& s : buckets[i].slots) {
+            uint64_t data = s.data.load(std::memory_order_relaxed);
+            if (data != 0 && dataGen(data) == gen) ++used;
+        }
+    return n ? (int)(used * 1000 / (n * BUCKET_SLOTS)) : 0;
+}
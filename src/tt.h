@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// ======================================================
+// Transposition Table (TT)
+//
+// Tabela de tamanho fixo (potência de 2) em buckets de 64 bytes
+// (uma cache line) com 4 entradas compactas de 16 bytes.
+// Cada entrada guarda {key ^ data, data}: as escritas são feitas sem
+// locks e uma leitura "rasgada" por outra thread simplesmente não
+// passa a verificação da key.
+// Em vez de limpar a tabela, cada pesquisa avança uma geração; as
+// entradas antigas são as primeiras a ser substituídas.
+// ======================================================
+
+enum class TTFlag : uint8_t {
+    EXACT,
+    LOWERBOUND,
+    UPPERBOUND
+};
+
+// Vista descompactada de uma entrada
+struct TTEntry {
+    float value = 0.0f;
+    int depth = 0;
+    TTFlag flag = TTFlag::EXACT;
+    // também guardamos bestMove para move ordering (-1 = nenhum)
+    int bestMoveHandIdx = -1;
+};
+
+class TranspositionTable {
+public:
+    static constexpr size_t DEFAULT_MB = 64;
+
+    explicit TranspositionTable(size_t mb = DEFAULT_MB) { resize(mb); }
+
+    // Realoca (e limpa) a tabela com ~mb megabytes (arredonda para 2^n buckets)
+    void resize(size_t mb);
+    void clear();
+
+    // Chamar no início de cada pesquisa na root
+    void newSearch() { generation.fetch_add(1, std::memory_order_relaxed); }
+
+    bool probe(uint64_t key, TTEntry& out) const;
+    void store(uint64_t key, const TTEntry& e);
+
+    size_t sizeMB() const { return (bucketCount * sizeof(Bucket)) >> 20; }
+
+    // Ocupação aproximada (por mil) com entradas da geração atual
+    int hashfull() const;
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> keyXorData{0};
+        std::atomic<uint64_t> data{0};
+    };
+
+    static constexpr int BUCKET_SLOTS = 4;
+
+    struct alignas(64) Bucket {
+        Slot slots[BUCKET_SLOTS];
+    };
+
+    std::unique_ptr<Bucket[]> buckets;
+    size_t bucketCount = 0;
+    std::atomic<uint8_t> generation{0};
+};
+
+extern TranspositionTable g_TT;
@@ -6,6 +6,7 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <string>
@@ -14,10 +15,14 @@
 #include <vector>
 
 #include "eval_nnue.h"
+#include "eval_server.h"
+#include "eval_cache.h"
+#include "nnue_reload.h"
 #include "gamestate.h"
 #include "mcts.h"
 #include "rand.h"
 #include "selfplay_mcts.h"
+#include "tablebase.h"
 
 static bool g_rootMTFlag = false;
 
@@ -26,9 +31,11 @@ struct EngineContextMCTS {
     MCTSConfig cfg;
     bool perfectInfo = false;
     RNG rng;
-    NNUEWeights weights;
-    bool hasNNUE = false;
-    std::string nnuePath;
+    NNUENetSlot nets; // rede atual; setoption nnue / reloadnet trocam-na a quente
+
+    // Árvore de cada jogador, reaproveitada entre lances (cfg.reuseTree)
+    std::unique_ptr<MCTSSearch> trees[2];
+    uint64_t treesNetId = 0; // rede com que as árvores foram construídas
 
     EngineContextMCTS()
         : rng(randomSeed()) {}
@@ -62,23 +69,59 @@ static bool applyMoveEngine(GameState& st, RNG& rng, int idx) {
 
 static void cmdNewGame(EngineContextMCTS& ctx) {
     ctx.state.newGame(ctx.rng);
+    for (auto& t : ctx.trees) t.reset();
     std::cout << "Novo jogo (MCTS) iniciado.\n";
     cmdShow(ctx.state);
 }
 
 static void cmdPlay(EngineContextMCTS& ctx, int idx) {
+    const int card = ctx.state.handCardId(ctx.state.currentPlayer, idx);
     if (!applyMoveEngine(ctx.state, ctx.rng, idx)) {
         std::cout << "Jogada inválida (idx=" << idx << ").\n";
         return;
     }
+    for (auto& t : ctx.trees)
+        if (t) t->advance(card);
     std::cout << "Jogada efetuada (idx " << idx << ").\n";
     cmdShow(ctx.state);
 }
 
 static void cmdBestMove(EngineContextMCTS& ctx) {
+    // snapshot da rede: uma troca a meio não afeta esta pesquisa
+    const std::shared_ptr<const NNUEWeights> net = ctx.nets.current();
+    ctx.cfg.weights = net.get();
+    ctx.cfg.useNNUE = (net != nullptr);
+
+    // valores de outra rede não servem: árvores novas
+    const uint64_t netId = net ? net->id : 0;
+    if (netId != ctx.treesNetId) {
+        for (auto& t : ctx.trees) t.reset();
+        ctx.treesNetId = netId;
+    }
+
     const int player = ctx.state.currentPlayer;
     RNG searchRng(ctx.rng.nextU64() ^ 0x9e3779b97f4a7c15ULL);
-    MCTSResult res = searchBestMoveMCTS(ctx.state, player, searchRng, ctx.cfg);
+    std::unique_ptr<MCTSSearch>& tree = ctx.trees[player];
+    int reused = 0;
+    MCTSResult res;
+    if (ctx.cfg.rootTrees > 1) {
+        // ensemble root-parallel: árvores novas a cada lance
+        res = searchBestMoveMCTS(ctx.state, player, searchRng, ctx.cfg);
+    } else {
+        if (tree) reused = tree->reroot(ctx.state, player, ctx.cfg);
+        else tree = std::make_unique<MCTSSearch>(ctx.state, player, ctx.cfg);
+        res = searchBestMoveMCTS(*tree, searchRng, ctx.cfg);
+        if (!ctx.cfg.reuseTree) tree.reset();
+    }
+    ctx.cfg.weights = nullptr;
+
+    if (reused > 0) std::cout << "info reuse visits=" << reused << "\n";
+
+    if (g_evalCache.enabled() && ctx.cfg.useNNUE) {
+        std::cout << "info evalcache hits=" << g_evalCache.hits() << "/" << g_evalCache.probes()
+                  << " (" << 100.0 * g_evalCache.hitRate() << "%)\n";
+        g_evalCache.resetStats();
+    }
 
     std::cout << "bestmove index=" << res.chosenMoveIndex
               << " eval=" << std::fixed << std::setprecision(4) << res.eval
@@ -90,33 +133,57 @@ static int runEngineMode(MCTSConfig cfg, bool perfectInfo, const std::string& nn
     ctx.cfg = cfg;
     ctx.perfectInfo = perfectInfo;
     ctx.cfg.perfectInfo = perfectInfo;
-    ctx.nnuePath = nnuePath;
+    bool hasNNUE = false;
     if (!nnuePath.empty()) {
-        if (loadWeights(ctx.weights, nnuePath)) {
-            ctx.hasNNUE = true;
-            ctx.cfg.weights = &ctx.weights;
-            ctx.cfg.useNNUE = true;
+        auto weights = std::make_shared<NNUEWeights>();
+        if (loadWeights(*weights, nnuePath)) {
+            hasNNUE = true;
+            ctx.nets.publish(std::move(weights), nnuePath);
         } else {
             std::cerr << "Aviso: nao consegui carregar NNUE '" << nnuePath
                       << "'. Continuando com rollouts aleatorios.\n";
         }
     }
 
+    if (cfg.valueNet && !hasNNUE)
+        std::cerr << "Aviso: --value-net sem NNUE; as folhas usam rollouts aleatorios ate carregar uma rede.\n";
+
     std::cout << "Bisca4 MCTS Engine pronto. "
               << "iters=" << cfg.iterations
               << " cpuct=" << cfg.exploration
               << " perfectInfo=" << (perfectInfo ? 1 : 0)
-              << " nnue=" << (ctx.hasNNUE ? nnuePath : "none")
+              << " ismcts=" << (cfg.informationSet ? 1 : 0)
+              << " threads=" << cfg.threads
+              << " rootTrees=" << cfg.rootTrees
+              << " valueNet=" << (cfg.valueNet ? 1 : 0)
+              << " leafBatch=" << cfg.leafBatch
+              << " nnue=" << (hasNNUE ? nnuePath : "none")
               << "\n";
 
     cmdNewGame(ctx);
 
     std::string line;
     while (std::getline(std::cin, line)) {
+        std::string status;
+        if (ctx.nets.takeStatus(status)) std::cout << status << "\n";
+
         std::istringstream iss(line);
         std::string cmd;
         iss >> cmd;
         if (cmd == "quit" || cmd == "exit") break;
+        else if (cmd == "setoption" || cmd == "reloadnet") {
+            std::string name, path;
+            if (cmd == "setoption") {
+                iss >> name >> path;
+                if (name != "nnue") { std::cout << "Opcao desconhecida.\n"; continue; }
+            } else {
+                iss >> path;
+                if (path.empty()) path = ctx.nets.path();
+            }
+            if (path.empty()) std::cout << "Sem caminho de NNUE para carregar.\n";
+            else if (!ctx.nets.loadAsync(path)) std::cout << "Ja ha uma NNUE a carregar.\n";
+            else std::cout << "info nnue a carregar " << path << "\n";
+        }
         else if (cmd == "newgame") cmdNewGame(ctx);
         else if (cmd == "show") cmdShow(ctx.state);
         else if (cmd == "bestmove") cmdBestMove(ctx);
@@ -134,7 +201,10 @@ static int runSelfPlayMode(const std::string& outDataset,
                            int games,
                            MCTSConfig cfg,
                            int threads,
-                           const std::string& nnuePath)
+                           const std::string& nnuePath,
+                           int gamesPerThread,
+                           bool useEvalServer,
+                           const EvalServerConfig& serverCfg)
 {
     NNUEWeights weights;
     bool hasNNUE = false;
@@ -149,14 +219,25 @@ static int runSelfPlayMode(const std::string& outDataset,
         }
     }
 
+    if (cfg.valueNet && !hasNNUE)
+        std::cerr << "Aviso: --value-net sem NNUE; as folhas usam rollouts aleatorios.\n";
+
     std::vector<SelfPlaySampleMCTS> allSamples;
     allSamples.reserve(games * 40);
     std::mutex samplesMutex;
     std::atomic<long> totalScoreDiff{0};
 
+    // Cada thread intercala gamesPerThread jogos e avalia as folhas em
+    // lote; com o servidor os lotes de todas as threads juntam-se
+    std::unique_ptr<NNUEEvalServer> server;
+    if (useEvalServer && hasNNUE) {
+        server = std::make_unique<NNUEEvalServer>(weights, cfg.perfectInfo, serverCfg);
+    }
+
     int hw = static_cast<int>(std::thread::hardware_concurrency());
     if (threads <= 0) threads = std::max(1, hw);
-    threads = std::max(1, std::min(threads, games));
+    gamesPerThread = std::max(1, gamesPerThread);
+    threads = std::max(1, std::min(threads, (games + gamesPerThread - 1) / gamesPerThread));
 
     std::cout << "Self-play MCTS paralelo: threads=" << threads
               << ", jogos=" << games
@@ -164,8 +245,13 @@ static int runSelfPlayMode(const std::string& outDataset,
               << ", cpuct=" << cfg.exploration
               << ", perfectInfo=" << (cfg.perfectInfo ? 1 : 0)
               << ", nnue=" << (hasNNUE ? nnuePath : "none")
+              << ", rolloutLimit=" << cfg.rolloutLimit
+              << ", valueNet=" << (cfg.valueNet ? 1 : 0)
+              << ", jogosPorThread=" << gamesPerThread
+              << ", evalServer=" << (server ? 1 : 0)
               << "\n";
 
+    auto t0 = std::chrono::steady_clock::now();
     std::vector<std::thread> workers;
     workers.reserve(threads);
     std::atomic<int> gameCounter{0};
@@ -173,20 +259,24 @@ static int runSelfPlayMode(const std::string& outDataset,
     for (int t = 0; t < threads; ++t) {
         workers.emplace_back([&, t]() {
             RNG localRng(randomSeed() ^ (0x9e3779b97f4a7c15ULL * (t + 1)));
+            NNUEEvalServer::Client client(server.get());
             std::vector<SelfPlaySampleMCTS> local;
             local.reserve(1000);
 
             while (true) {
-                int g = gameCounter.fetch_add(1);
+                int g = gameCounter.fetch_add(gamesPerThread);
                 if (g >= games) break;
-
-                auto samples = playSelfPlayGameMCTS(cfg, localRng);
-                if (!samples.empty()) {
-                    totalScoreDiff += static_cast<long>(std::lround(samples[0].outcome));
+                const int n = std::min(gamesPerThread, games - g);
+
+                auto batch = playSelfPlayGamesMCTS(cfg, n, localRng, server.get());
+                for (auto& samples : batch) {
+                    if (!samples.empty()) {
+                        totalScoreDiff += static_cast<long>(std::lround(samples[0].outcome));
+                    }
+                    local.insert(local.end(),
+                                 std::make_move_iterator(samples.begin()),
+                                 std::make_move_iterator(samples.end()));
                 }
-                local.insert(local.end(),
-                             std::make_move_iterator(samples.begin()),
-                             std::make_move_iterator(samples.end()));
 
                 if (local.size() > 5000) {
                     std::lock_guard<std::mutex> lock(samplesMutex);
@@ -208,7 +298,18 @@ static int runSelfPlayMode(const std::string& outDataset,
 
     for (auto& th : workers) th.join();
 
-    std::cout << "Total samples: " << allSamples.size() << "\n";
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "Total samples: " << allSamples.size()
+              << " (" << secs << "s, " << (secs > 0.0 ? games / secs : 0.0) << " jogos/s)\n";
+    if (g_evalCache.enabled() && hasNNUE) {
+        std::cout << "Cache de avaliacao: hits=" << g_evalCache.hits() << "/" << g_evalCache.probes()
+                  << " (" << 100.0 * g_evalCache.hitRate() << "%)\n";
+    }
+    if (server) {
+        const uint64_t ev = server->evalCount(), nb = server->batchCount();
+        std::cout << "Servidor NNUE: avaliacoes=" << ev << " lotes=" << nb
+                  << " media/lote=" << (nb ? (double)ev / nb : 0.0) << "\n";
+    }
 
     if (!saveSamplesMCTS(allSamples, outDataset)) {
         std::cerr << "ERRO: não consegui escrever dataset em " << outDataset << "\n";
@@ -240,7 +341,18 @@ int main(int argc, char** argv) {
     float cpuct = 1.41421356f;
     int threads = 0;
     bool perfectInfo = false;
+    bool ismcts = false;
+    bool reuseTree = true;
+    int rootTrees = 1;
+    int rolloutLimit = 0;
+    bool valueNet = false;
+    int leafBatch = 1;
+    int gamesPerThread = 1;
+    int evalCacheMB = (int)NNUEEvalCache::DEFAULT_MB;
+    bool useEvalServer = false;
+    EvalServerConfig serverCfg;
     std::string nnuePath;
+    std::string tbPath;
 
     for (int i = 1; i < argc; ++i) {
         std::string a = argv[i];
@@ -251,23 +363,52 @@ int main(int argc, char** argv) {
         else if (a == "--depth" && i + 1 < argc) iterations = std::max(1, std::atoi(argv[++i]));
         else if (a == "--cpuct" && i + 1 < argc) cpuct = std::max(0.01f, static_cast<float>(std::atof(argv[++i])));
         else if (a == "--threads" && i + 1 < argc) threads = std::max(0, std::atoi(argv[++i]));
+        else if (a == "--ismcts") ismcts = true;
+        else if (a == "--no-tree-reuse") reuseTree = false;
+        else if (a == "--root-trees" && i + 1 < argc) rootTrees = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--rollout-limit" && i + 1 < argc) rolloutLimit = std::max(0, std::atoi(argv[++i]));
+        else if (a == "--value-net") valueNet = true;
+        else if (a == "--leaf-batch" && i + 1 < argc) leafBatch = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--games-per-thread" && i + 1 < argc) gamesPerThread = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--evalcache" && i + 1 < argc) evalCacheMB = std::max(0, std::atoi(argv[++i]));
+        else if (a == "--eval-server") useEvalServer = true;
+        else if (a == "--eval-threads" && i + 1 < argc) serverCfg.threads = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--eval-batch" && i + 1 < argc) serverCfg.maxBatch = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--eval-wait-us" && i + 1 < argc) serverCfg.maxWaitMicros = std::max(0, std::atoi(argv[++i]));
         else if (a == "--info" && i + 1 < argc) {
             std::string inf = argv[++i];
             perfectInfo = (inf == "perfect");
         } else if (a == "--nnue" && i + 1 < argc) {
             nnuePath = argv[++i];
+        } else if (a == "--tb" && i + 1 < argc) {
+            tbPath = argv[++i];
         }
     }
 
+    if (!tbPath.empty() && !loadTablebase(tbPath)) {
+        std::cerr << "Aviso: nao consegui carregar a tablebase '" << tbPath << "'.\n";
+    }
+
+    if (evalCacheMB != (int)g_evalCache.sizeMB()) g_evalCache.resize((size_t)evalCacheMB);
+
     MCTSConfig cfg;
     cfg.iterations = iterations;
     cfg.exploration = cpuct;
     cfg.perfectInfo = perfectInfo;
+    cfg.informationSet = ismcts;
+    cfg.rolloutLimit = rolloutLimit;
+    cfg.valueNet = valueNet;
+    cfg.leafBatch = leafBatch;
+    cfg.reuseTree = reuseTree;
+    cfg.rootTrees = rootTrees;
 
     if (mode == "engine") {
+        // no engine as threads partilham a árvore de cada bestmove
+        cfg.threads = std::max(1, threads);
         return runEngineMode(cfg, perfectInfo, nnuePath);
     } else if (mode == "selfplay") {
-        return runSelfPlayMode(datasetPath, games, cfg, threads, nnuePath);
+        return runSelfPlayMode(datasetPath, games, cfg, threads, nnuePath,
+                               gamesPerThread, useEvalServer, serverCfg);
     }
 
     std::cerr << "Modo desconhecido '" << mode << "'.\n";
@@ -1,114 +1,292 @@
 #include "mcts.h"
+#include "endgame.h"
+#include "eval_cache.h"
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <limits>
 #include <memory>
+#include <thread>
 #include <vector>
 
 namespace {
 
-GameState applyMoveDeterministic(const GameState& st, int player, int handIndex) {
-    GameState ns = st;
-    if (!ns.playCard(player, handIndex)) {
-        return ns;
+// Joga em `st` (sem cópia); fecha a vaza se ficou completa
+void applyMoveDeterministic(GameState& st, int player, int handIndex) {
+    if (!st.playCard(player, handIndex)) {
+        return;
     }
     RNG rng(1234);
-    ns.maybeCloseTrick(rng);
-    return ns;
+    st.maybeCloseTrick(rng);
 }
 
-void shuffleMoves(std::vector<int>& moves, RNG& rng) {
+// Valor da NNUE (≈ diferença final de pontos × g_evalPerPoint, ponto de
+// vista de rootPlayer) na escala dos resultados da árvore, diff / 120 em
+// [-1, 1]
+float nnueLeafValue(float eval) {
+    const float v = eval / (g_evalPerPoint * 120.0f);
+    return std::max(-1.0f, std::min(1.0f, v));
+}
+
+void shuffleMoves(MoveList& moves, RNG& rng) {
     if (moves.empty()) return;
-    for (int i = static_cast<int>(moves.size()) - 1; i > 0; --i) {
+    for (int i = moves.size() - 1; i > 0; --i) {
         int j = static_cast<int>(rng.nextU32() % static_cast<uint32_t>(i + 1));
         std::swap(moves[i], moves[j]);
     }
 }
 
+// Perda virtual (tree-parallel): enquanto uma iteração está a meio, cada
+// nó do seu caminho conta já uma visita e uma derrota para quem o
+// escolheu, para as outras threads preferirem outros ramos. Os valores
+// estão em [-1, 1], por isso 1.0 é uma derrota completa.
+constexpr float VIRTUAL_LOSS = 1.0f;
+
+void atomicAdd(std::atomic<float>& a, float v) {
+    float cur = a.load(std::memory_order_relaxed);
+    while (!a.compare_exchange_weak(cur, cur + v, std::memory_order_relaxed)) {
+    }
+}
+
+// ======================================================
+// Árvore numa arena por pesquisa
+//
+// Os nós vivem num array contíguo e referem-se por índice; os filhos de
+// um nó são um intervalo [firstChild, firstChild + numMoves) reservado na
+// sua 1ª expansão, dos quais só os numExpanded primeiros estão em uso.
+// Os nós não guardam o GameState: cada iteração refaz o estado jogando os
+// movimentos desde a raiz enquanto desce. As estatísticas ficam num array
+// à parte (paralelo) para a seleção só tocar no que precisa, e a árvore
+// inteira liberta-se de uma vez com a arena.
+//
+// Com várias threads na mesma árvore a arena é reservada antes e não
+// cresce (tryAdd falha se encher); o que muda depois de o nó existir
+// (filhos, contadores) é atómico e a expansão é sem locks: cada thread
+// reserva um filho com CAS em numExpanded e publica-o com `ready`.
+// ======================================================
+
+struct NodeStats {
+    std::atomic<int> visits{0};
+    std::atomic<float> totalValue{0.0f}; // armazenado da perspetiva do jogador root
+
+    int n() const { return visits.load(std::memory_order_relaxed); }
+    float w() const { return totalValue.load(std::memory_order_relaxed); }
+    // Com uma só thread na árvore basta ler e escrever (sem lock)
+    void add(int v, float value, bool concurrent) {
+        if (!concurrent) {
+            visits.store(n() + v, std::memory_order_relaxed);
+            totalValue.store(w() + value, std::memory_order_relaxed);
+            return;
+        }
+        if (v) visits.fetch_add(v, std::memory_order_relaxed);
+        atomicAdd(totalValue, value);
+    }
+    void copyFrom(const NodeStats& o) {
+        visits.store(o.n(), std::memory_order_relaxed);
+        totalValue.store(o.w(), std::memory_order_relaxed);
+    }
+};
+
 struct Node {
-    GameState state;
-    int playerToMove = 0;
-    int moveFromParent = -1;
-    Node* parent = nullptr;
-    std::vector<int> unexpandedMoves;
-
-    struct Child {
-        int move;
-        std::unique_ptr<Node> node;
-    };
+    int32_t parent = -1;
+    std::atomic<int32_t> firstChild{-1}; // -1 até à 1ª expansão
+    std::atomic<uint8_t> numExpanded{0};
+    std::atomic<bool> ready{false};      // campos abaixo já escritos
+    uint8_t move = 0;        // índice na mão jogado pelo pai
+    uint8_t playerToMove = 0;
+    uint8_t numMoves = 0;    // jogadas legais
+    uint8_t order = 0;       // jogadas pela ordem de expansão, 2 bits cada
+
+    int moveAt(int i) const { return (order >> (2 * i)) & 3; }
+    // Expande pela ordem inversa de `moves` (como o antigo pop_back)
+    void setMoves(const MoveList& moves) {
+        numMoves = static_cast<uint8_t>(moves.size());
+        order = 0;
+        for (int i = 0; i < moves.size(); ++i)
+            order |= static_cast<uint8_t>(moves[moves.size() - 1 - i] << (2 * i));
+    }
+    void copyFrom(const Node& o) {
+        parent = o.parent;
+        firstChild.store(o.firstChild.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        numExpanded.store(o.numExpanded.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        ready.store(o.ready.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        move = o.move;
+        playerToMove = o.playerToMove;
+        numMoves = o.numMoves;
+        order = o.order;
+    }
+};
+
+template <class N>
+struct Arena {
+    std::unique_ptr<N[]> nodes;
+    std::unique_ptr<NodeStats[]> stats;
+    int capacity = 0;
+    std::atomic<int> count{0};
+
+    Arena() = default;
+    Arena(Arena&& o) noexcept { *this = std::move(o); }
+    Arena& operator=(Arena&& o) noexcept {
+        nodes = std::move(o.nodes);
+        stats = std::move(o.stats);
+        capacity = o.capacity;
+        count.store(o.count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        o.capacity = 0;
+        o.count.store(0, std::memory_order_relaxed);
+        return *this;
+    }
 
-    std::vector<Child> children;
-    int visits = 0;
-    float totalValue = 0.0f; // armazenado da perspetiva do jogador root
+    int size() const { return std::min(count.load(std::memory_order_relaxed), capacity); }
+
+    // Só com uma thread na árvore
+    void reserve(int n) {
+        if (n <= capacity) return;
+        std::unique_ptr<N[]> nn(new N[n]);
+        std::unique_ptr<NodeStats[]> ns(new NodeStats[n]);
+        const int used = size();
+        for (int i = 0; i < used; ++i) {
+            nn[i].copyFrom(nodes[i]);
+            ns[i].copyFrom(stats[i]);
+        }
+        nodes = std::move(nn);
+        stats = std::move(ns);
+        capacity = n;
+        count.store(used, std::memory_order_relaxed);
+    }
+    // n nós novos (por defeito) contíguos; só com uma thread (pode crescer)
+    int add(int n) {
+        const int first = size();
+        if (first + n > capacity) reserve(std::max(2 * capacity, first + n));
+        count.store(first + n, std::memory_order_relaxed);
+        return first;
+    }
+    // Idem entre várias threads: -1 se a arena encheu
+    int tryAdd(int n) {
+        const int first = count.fetch_add(n, std::memory_order_relaxed);
+        return first + n <= capacity ? first : -1;
+    }
 };
 
-Node* selectNode(Node* node, int rootPlayer, const MCTSConfig& cfg) {
+using Tree = Arena<Node>;
+
+// Desce por UCB a partir da raiz, jogando em `state`; devolve o nó onde
+// parar (tem jogadas por expandir, é terminal ou não tem filhos). Com
+// perda virtual cada nó escolhido fica logo com a visita e a derrota.
+int selectNode(Tree& t, GameState& state, int rootPlayer, const MCTSConfig& cfg, bool virtualLoss) {
+    int node = 0;
+    if (virtualLoss) t.stats[0].add(1, 0.0f, true);
     while (true) {
-        if (!node->unexpandedMoves.empty() || node->state.finished || node->children.empty()) {
+        const Node& n = t.nodes[node];
+        const int ne = n.numExpanded.load(std::memory_order_acquire);
+        if (ne < n.numMoves || state.finished || ne == 0) {
             return node;
         }
 
         float bestScore = -std::numeric_limits<float>::infinity();
-        Node* bestChild = nullptr;
-        float parentVisits = static_cast<float>(node->visits + 1);
-
-        for (auto& edge : node->children) {
-            Node* child = edge.node.get();
+        int bestChild = -1;
+        float parentVisits = static_cast<float>(t.stats[node].n() + 1);
+
+        const int first = n.firstChild.load(std::memory_order_acquire);
+        for (int c = first; c < first + ne; ++c) {
+            if (!t.nodes[c].ready.load(std::memory_order_acquire)) continue;
+            const NodeStats& cs = t.stats[c];
+            const int visits = cs.n();
             float score;
-            if (child->visits == 0) {
+            if (visits == 0) {
                 score = std::numeric_limits<float>::infinity();
             } else {
-                float mean = child->totalValue / static_cast<float>(child->visits);
-                if (node->playerToMove != rootPlayer) {
+                float mean = cs.w() / static_cast<float>(visits);
+                if (n.playerToMove != rootPlayer) {
                     mean = -mean; // adversário tenta minimizar
                 }
                 float explore = cfg.exploration *
-                                std::sqrt(std::log(parentVisits) / static_cast<float>(child->visits));
+                                std::sqrt(std::log(parentVisits) / static_cast<float>(visits));
                 score = mean + explore;
             }
 
             if (score > bestScore) {
                 bestScore = score;
-                bestChild = child;
+                bestChild = c;
             }
         }
 
-        if (!bestChild) {
+        if (bestChild < 0) {
             return node;
         }
+        if (virtualLoss)
+            t.stats[bestChild].add(1, n.playerToMove == rootPlayer ? -VIRTUAL_LOSS : VIRTUAL_LOSS, true);
+        applyMoveDeterministic(state, n.playerToMove, t.nodes[bestChild].move);
         node = bestChild;
     }
 }
 
-Node* expandNode(Node* node, int rootPlayer, RNG& rng) {
-    if (node->unexpandedMoves.empty()) {
+// `state` é a posição de `node`; passa a ser a do filho devolvido.
+// Com `concurrent` a arena não cresce e o filho é reservado com CAS.
+int expandNode(Tree& t, int node, GameState& state, RNG& rng, int rootPlayer,
+               bool concurrent) {
+    const int numMoves = t.nodes[node].numMoves;
+    if (t.nodes[node].numExpanded.load(std::memory_order_relaxed) >= numMoves) {
         return node;
     }
 
-    int move = node->unexpandedMoves.back();
-    node->unexpandedMoves.pop_back();
-
-    GameState next = applyMoveDeterministic(node->state, node->playerToMove, move);
-    auto child = std::make_unique<Node>();
-    child->state = next;
-    child->playerToMove = next.currentPlayer;
-    child->moveFromParent = move;
-    child->parent = node;
-    child->unexpandedMoves = next.getLegalMoves(child->playerToMove);
-    shuffleMoves(child->unexpandedMoves, rng);
+    if (t.nodes[node].firstChild.load(std::memory_order_acquire) < 0) {
+        if (concurrent) {
+            const int first = t.tryAdd(numMoves);
+            if (first < 0) return node; // arena cheia: a folha fica aqui
+            int32_t expected = -1;
+            // se outra thread ganhou, os nossos nós ficam por usar
+            t.nodes[node].firstChild.compare_exchange_strong(expected, first, std::memory_order_acq_rel);
+        } else {
+            const int first = t.add(numMoves);
+            t.nodes[node].firstChild.store(first, std::memory_order_relaxed);
+        }
+    }
 
-    Node* childPtr = child.get();
-    node->children.push_back(Node::Child{move, std::move(child)});
-    return childPtr;
+    Node& n = t.nodes[node];
+    uint8_t k = n.numExpanded.load(std::memory_order_relaxed);
+    do {
+        if (k >= numMoves) return node;
+    } while (!n.numExpanded.compare_exchange_weak(k, static_cast<uint8_t>(k + 1),
+                                                  std::memory_order_acq_rel));
+
+    const int move = n.moveAt(k);
+    const int c = n.firstChild.load(std::memory_order_acquire) + k;
+    const int mover = n.playerToMove;
+    applyMoveDeterministic(state, mover, move);
+
+    Node& child = t.nodes[c];
+    child.parent = node;
+    child.move = static_cast<uint8_t>(move);
+    child.playerToMove = static_cast<uint8_t>(state.currentPlayer);
+    MoveList moves = state.getLegalMoves(state.currentPlayer);
+    shuffleMoves(moves, rng);
+    child.setMoves(moves);
+    if (concurrent)
+        t.stats[c].add(1, mover == rootPlayer ? -VIRTUAL_LOSS : VIRTUAL_LOSS, true);
+    child.ready.store(true, std::memory_order_release);
+    return c;
 }
 
-float rollout(GameState state,
-              int rootPlayer,
-              RNG& rng,
-              const MCTSConfig& cfg) {
+// Joga ao acaso até ao fim do jogo, ao fim das compras ou a
+// cfg.rolloutLimit jogadas (com cfg.valueNet 0 = nenhuma: a folha vai
+// logo para a NNUE). Sem NNUE carregada joga sempre até ao fim. Devolve
+// true se a folha precisa da NNUE (`state` fica nessa posição); senão
+// `value` já tem o resultado.
+bool rolloutToLeaf(GameState& state,
+                   int rootPlayer,
+                   RNG& rng,
+                   const MCTSConfig& cfg,
+                   float& value) {
+    constexpr float normalizer = 120.0f;
+    const bool truncate = cfg.useNNUE && cfg.weights && (cfg.valueNet || cfg.rolloutLimit > 0);
     int steps = 0;
     while (!state.finished) {
-        if (cfg.rolloutLimit > 0 && steps >= cfg.rolloutLimit) {
+        // sem compras: resultado exato em vez de jogadas aleatórias
+        if (state.noMoreCardsToDraw()) {
+            value = static_cast<float>(endgameFinalDiff(state, rootPlayer)) / normalizer;
+            return false;
+        }
+        if (truncate && steps >= cfg.rolloutLimit) {
             break;
         }
 
@@ -118,90 +296,708 @@ float rollout(GameState state,
             break;
         }
 
-        int choice = moves[static_cast<size_t>(rng.nextU32() % moves.size())];
-        state = applyMoveDeterministic(state, player, choice);
+        int choice = moves[static_cast<int>(rng.nextU32() % static_cast<uint32_t>(moves.size()))];
+        applyMoveDeterministic(state, player, choice);
         steps++;
     }
 
     int other = 1 - rootPlayer;
     int diff = state.score[rootPlayer] - state.score[other];
-    constexpr float normalizer = 120.0f;
 
     if (state.finished || !cfg.useNNUE || !cfg.weights) {
-        return static_cast<float>(diff) / normalizer;
+        value = static_cast<float>(diff) / normalizer;
+        return false;
+    }
+    return true;
+}
+
+// Com perda virtual as visitas já foram contadas na descida: só se soma
+// o valor e se desfaz a derrota virtual
+void backpropagate(Tree& t, int node, float value, int rootPlayer, bool virtualLoss) {
+    while (node >= 0) {
+        const int parent = t.nodes[node].parent;
+        if (!virtualLoss) {
+            t.stats[node].add(1, value, false);
+        } else {
+            float undo = 0.0f;
+            if (parent >= 0)
+                undo = t.nodes[parent].playerToMove == rootPlayer ? VIRTUAL_LOSS : -VIRTUAL_LOSS;
+            t.stats[node].add(0, value + undo, true);
+        }
+        node = parent;
+    }
+}
+
+// ======================================================
+// SO-ISMCTS (single observer, Cowling et al.)
+//
+// Uma só árvore por conjunto de informação do rootPlayer: as arestas são
+// cartas (cardId), não índices na mão, e cada iteração joga numa nova
+// determinização (mão do adversário + ordem do monte). Um filho só entra
+// no UCB se a carta for jogável nessa determinização, e o log usa o nº de
+// vezes que esteve disponível em vez das visitas do pai.
+// ======================================================
+
+// Mesma arena; os filhos variam com a determinização, por isso ficam
+// numa lista ligada por índices (pela ordem de criação). Um nó é escrito
+// por inteiro antes de ser ligado (CAS no fim da lista), por isso quem o
+// encontra na lista já o vê completo.
+struct ISNode {
+    int32_t parent = -1;
+    std::atomic<int32_t> firstChild{-1};
+    std::atomic<int32_t> nextSibling{-1};
+    int8_t card = -1;            // carta jogada para chegar aqui
+    int8_t playerJustMoved = -1;
+    std::atomic<int> availability{0};
+
+    void copyFrom(const ISNode& o) {
+        parent = o.parent;
+        firstChild.store(o.firstChild.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        nextSibling.store(o.nextSibling.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        card = o.card;
+        playerJustMoved = o.playerJustMoved;
+        availability.store(o.availability.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+};
+
+using ISTree = Arena<ISNode>;
+
+// Liga o nó novo `c` (carta `id`) no fim da lista de filhos de `node`.
+// Se entretanto outra thread ligou a mesma carta, devolve esse nó (e `c`
+// fica por usar).
+int linkChildIS(ISTree& t, int node, int c, int id) {
+    std::atomic<int32_t>* link = &t.nodes[node].firstChild;
+    for (;;) {
+        int32_t cur = link->load(std::memory_order_acquire);
+        if (cur < 0) {
+            if (link->compare_exchange_strong(cur, c, std::memory_order_acq_rel)) return c;
+        }
+        if (t.nodes[cur].card == id) return cur;
+        link = &t.nodes[cur].nextSibling;
+    }
+}
+
+// Desce a árvore jogando em `world`; devolve o nó a avaliar
+int selectExpandIS(ISTree& t, GameState& world, int rootPlayer,
+                   RNG& rng, const MCTSConfig& cfg, bool concurrent)
+{
+    int node = 0;
+    if (concurrent) t.stats[0].add(1, 0.0f, true);
+    while (!world.finished) {
+        const int p = world.currentPlayer;
+        CardMask legal = world.hands[p];
+        if (!legal) break;
+        const float vl = p == rootPlayer ? -VIRTUAL_LOSS : VIRTUAL_LOSS;
+
+        CardMask untried = legal;
+        for (int c = t.nodes[node].firstChild.load(std::memory_order_acquire); c >= 0;
+             c = t.nodes[c].nextSibling.load(std::memory_order_acquire)) {
+            untried &= ~cardBit(t.nodes[c].card);
+        }
+
+        int id;
+        if (untried) {
+            int n = popcount64(untried);
+            int k = static_cast<int>(rng.nextU32() % static_cast<uint32_t>(n));
+            while (k-- > 0) untried &= untried - 1;
+            id = lsb64(untried);
+
+            int c = concurrent ? t.tryAdd(1) : t.add(1);
+            if (c < 0) return node; // arena cheia: a folha fica aqui
+            ISNode& child = t.nodes[c];
+            child.parent = node;
+            child.card = static_cast<int8_t>(id);
+            child.playerJustMoved = static_cast<int8_t>(p);
+            child.availability.store(1, std::memory_order_relaxed);
+            if (concurrent) {
+                t.stats[c].add(1, vl, true);
+                const int got = linkChildIS(t, node, c, id);
+                if (got != c) {
+                    // a mesma carta entrou por outra thread: segue por ela
+                    t.nodes[got].availability.fetch_add(1, std::memory_order_relaxed);
+                    t.stats[got].add(1, vl, true);
+                    c = got;
+                }
+            } else {
+                linkChildIS(t, node, c, id);
+            }
+
+            // os irmãos jogáveis nesta determinização também estiveram
+            // disponíveis nesta visita (o escolhido já foi contado)
+            for (int s = t.nodes[node].firstChild.load(std::memory_order_acquire); s >= 0;
+                 s = t.nodes[s].nextSibling.load(std::memory_order_acquire)) {
+                ISNode& sn = t.nodes[s];
+                if (s == c || !(legal & cardBit(sn.card))) continue;
+                if (concurrent) {
+                    sn.availability.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    sn.availability.store(sn.availability.load(std::memory_order_relaxed) + 1,
+                                          std::memory_order_relaxed);
+                }
+            }
+
+            world.playCard(p, world.handIndexOf(p, id));
+            world.maybeCloseTrick(rng);
+            return c;
+        }
+
+        float bestScore = -std::numeric_limits<float>::infinity();
+        int best = -1;
+        for (int c = t.nodes[node].firstChild.load(std::memory_order_acquire); c >= 0;
+             c = t.nodes[c].nextSibling.load(std::memory_order_acquire)) {
+            ISNode& cn = t.nodes[c];
+            if (!(legal & cardBit(cn.card))) continue;
+            int avail;
+            if (concurrent) {
+                avail = cn.availability.fetch_add(1, std::memory_order_relaxed) + 1;
+            } else {
+                avail = cn.availability.load(std::memory_order_relaxed) + 1;
+                cn.availability.store(avail, std::memory_order_relaxed);
+            }
+            const NodeStats& cs = t.stats[c];
+            const int visits = std::max(1, cs.n());
+            float mean = cs.w() / static_cast<float>(visits);
+            if (cn.playerJustMoved != rootPlayer) mean = -mean;
+            float explore = cfg.exploration *
+                            std::sqrt(std::log(static_cast<float>(avail)) /
+                                      static_cast<float>(visits));
+            if (mean + explore > bestScore) {
+                bestScore = mean + explore;
+                best = c;
+            }
+        }
+        node = best;
+        if (concurrent) t.stats[node].add(1, vl, true);
+        world.playCard(p, world.handIndexOf(p, t.nodes[node].card));
+        world.maybeCloseTrick(rng);
     }
+    return node;
+}
 
-    return nnueEvaluate(*cfg.weights, state, rootPlayer, cfg.perfectInfo);
+void backpropagateIS(ISTree& t, int node, float value, int rootPlayer, bool virtualLoss) {
+    while (node >= 0) {
+        const ISNode& n = t.nodes[node];
+        if (!virtualLoss) {
+            t.stats[node].add(1, value, false);
+        } else {
+            float undo = 0.0f;
+            if (n.parent >= 0) undo = n.playerJustMoved == rootPlayer ? VIRTUAL_LOSS : -VIRTUAL_LOSS;
+            t.stats[node].add(0, value + undo, true);
+        }
+        node = n.parent;
+    }
 }
 
-void backpropagate(Node* node, float value) {
-    while (node) {
-        node->visits += 1;
-        node->totalValue += value;
-        node = node->parent;
+// Copia a subárvore de `root` para uma arena nova (em largura, os
+// intervalos de filhos continuam contíguos); `root` passa a ser o nó 0
+Tree compactSubtree(const Tree& src, int root, int reserve) {
+    Tree out;
+    out.reserve(reserve);
+    std::vector<int> oldOf;
+    oldOf.reserve(reserve);
+
+    out.add(1);
+    out.nodes[0].copyFrom(src.nodes[root]);
+    out.nodes[0].parent = -1;
+    out.stats[0].copyFrom(src.stats[root]);
+    oldOf.push_back(root);
+
+    for (int i = 0; i < out.size(); ++i) {
+        const Node& on = src.nodes[oldOf[i]];
+        const int oldFirst = on.firstChild.load(std::memory_order_relaxed);
+        if (oldFirst < 0) continue;
+        const int first = out.add(on.numMoves);
+        for (int k = 0; k < on.numMoves; ++k) {
+            out.nodes[first + k].copyFrom(src.nodes[oldFirst + k]);
+            out.nodes[first + k].parent = i;
+            out.stats[first + k].copyFrom(src.stats[oldFirst + k]);
+            oldOf.push_back(oldFirst + k);
+        }
+        out.nodes[i].firstChild.store(first, std::memory_order_relaxed);
     }
+    return out;
+}
+
+ISTree compactSubtree(const ISTree& src, int root, int reserve) {
+    ISTree out;
+    out.reserve(reserve);
+    std::vector<int> oldOf;
+    oldOf.reserve(reserve);
+
+    out.add(1);
+    out.nodes[0].copyFrom(src.nodes[root]);
+    out.nodes[0].parent = -1;
+    out.nodes[0].firstChild.store(-1, std::memory_order_relaxed);
+    out.nodes[0].nextSibling.store(-1, std::memory_order_relaxed);
+    out.stats[0].copyFrom(src.stats[root]);
+    oldOf.push_back(root);
+
+    for (int i = 0; i < out.size(); ++i) {
+        int prev = -1;
+        for (int c = src.nodes[oldOf[i]].firstChild.load(std::memory_order_relaxed); c >= 0;
+             c = src.nodes[c].nextSibling.load(std::memory_order_relaxed)) {
+            const int nc = out.add(1);
+            ISNode& n = out.nodes[nc];
+            n.copyFrom(src.nodes[c]);
+            n.parent = i;
+            n.firstChild.store(-1, std::memory_order_relaxed);
+            n.nextSibling.store(-1, std::memory_order_relaxed);
+            out.stats[nc].copyFrom(src.stats[c]);
+            oldOf.push_back(c);
+            if (prev < 0) out.nodes[i].firstChild.store(nc, std::memory_order_relaxed);
+            else out.nodes[prev].nextSibling.store(nc, std::memory_order_relaxed);
+            prev = nc;
+        }
+    }
+    return out;
 }
 
 } // namespace
 
-MCTSResult searchBestMoveMCTS(const GameState& state,
-                              int rootPlayer,
-                              RNG& rng,
-                              const MCTSConfig& cfg)
+struct MCTSSearch::Impl {
+    GameState rootState;
+    int rootPlayer = 0;
+    MCTSConfig cfg;
+    int iter = 0;
+
+    // resultado sem árvore (sem jogadas / solver exato)
+    bool hasFixedResult = false;
+    MCTSResult fixedResult;
+
+    MoveList rootMoves;       // baralhadas na 1ª chamada a run()
+    bool shuffleRoot = false; // raiz nova, ainda por baralhar
+    Tree tree;                // UCT normal (raiz = treeRoot)
+    ISTree isTree;            // SO-ISMCTS (raiz = treeRoot)
+    int treeRoot = 0;         // avança com advance(); reroot() compacta
+    bool treeValid = false;   // advance() saiu da árvore
+    int pending = -1;         // folha à espera de provideValue
+
+    int expectedNodes() const {
+        // cada iteração cria no máx. um nó (UCT: reserva também os irmãos)
+        const int n = std::max(0, cfg.iterations) + 1;
+        return cfg.informationSet ? n : 2 * n;
+    }
+
+    // Resultado fixo (sem jogadas ou solver exato); false se há pesquisa
+    bool setFixedResult(const GameState& state) {
+        hasFixedResult = false;
+        fixedResult = MCTSResult{};
+        if (state.getLegalMoves(rootPlayer).empty()) {
+            hasFixedResult = true;
+            return true;
+        }
+        // Fim de jogo sem compras: o solver exato substitui a árvore
+        if (state.noMoreCardsToDraw() && state.currentPlayer == rootPlayer) {
+            EndgameResult eg = solveEndgame(state);
+            hasFixedResult = true;
+            fixedResult.chosenMoveIndex = eg.bestMove;
+            fixedResult.eval = static_cast<float>(state.score[rootPlayer] - state.score[1 - rootPlayer] + eg.margin) / 120.0f;
+            return true;
+        }
+        return false;
+    }
+
+    void freshTree() {
+        tree = Tree{};
+        isTree = ISTree{};
+        treeRoot = 0;
+        treeValid = true;
+        shuffleRoot = false;
+        if (cfg.informationSet) {
+            isTree.reserve(expectedNodes());
+            isTree.add(1);
+        } else {
+            tree.reserve(expectedNodes());
+            tree.add(1);
+            tree.nodes[0].playerToMove = static_cast<uint8_t>(rootPlayer);
+            tree.nodes[0].ready.store(true, std::memory_order_relaxed);
+            rootMoves = rootState.getLegalMoves(rootPlayer);
+            shuffleRoot = true;
+        }
+    }
+
+    void start(const GameState& state, int player) {
+        rootState = state;
+        rootPlayer = player;
+        iter = 0;
+        pending = -1;
+        if (setFixedResult(state)) {
+            tree = Tree{};
+            isTree = ISTree{};
+            treeValid = false;
+            return;
+        }
+        freshTree();
+    }
+
+    void prepareRoot(RNG& rng) {
+        // baralhar só aqui para consumir o rng pela ordem da versão não retomável
+        if (shuffleRoot) {
+            shuffleMoves(rootMoves, rng);
+            tree.nodes[0].setMoves(rootMoves);
+            shuffleRoot = false;
+        }
+    }
+
+    // Uma iteração até à folha: true se precisa da NNUE (posição em
+    // `leaf`, nó em `node`); senão `value` já tem o resultado
+    bool descend(RNG& rng, bool concurrent, GameState& leaf, int& node, float& value) {
+        if (cfg.informationSet) {
+            leaf = rootState;
+            leaf.randomizeHiddenInfo(rootPlayer, rng, cfg.perfectInfo);
+            node = selectExpandIS(isTree, leaf, rootPlayer, rng, cfg, concurrent);
+        } else {
+            leaf = rootState;
+            node = selectNode(tree, leaf, rootPlayer, cfg, concurrent);
+            if (!leaf.finished) {
+                node = expandNode(tree, node, leaf, rng, rootPlayer, concurrent);
+            }
+        }
+        return rolloutToLeaf(leaf, rootPlayer, rng, cfg, value);
+    }
+
+    void backup(int node, float value, bool concurrent) {
+        if (cfg.informationSet) backpropagateIS(isTree, node, value, rootPlayer, concurrent);
+        else backpropagate(tree, node, value, rootPlayer, concurrent);
+    }
+};
+
+MCTSSearch::MCTSSearch(const GameState& state, int rootPlayer, const MCTSConfig& cfg)
+    : impl(std::make_unique<Impl>())
 {
-    MCTSResult result;
-    auto moves = state.getLegalMoves(rootPlayer);
-    if (moves.empty()) {
-        result.eval = 0.0f;
-        result.chosenMoveIndex = -1;
-        result.visits = 0;
-        return result;
+    impl->cfg = cfg;
+    impl->start(state, rootPlayer);
+}
+
+MCTSSearch::~MCTSSearch() = default;
+
+bool MCTSSearch::run(RNG& rng, GameState& leaf) {
+    Impl& s = *impl;
+    if (s.hasFixedResult) return false;
+    s.prepareRoot(rng);
+
+    while (s.iter < s.cfg.iterations) {
+        ++s.iter;
+        float value = 0.0f;
+        int node = 0;
+        if (s.descend(rng, false, leaf, node, value)) {
+            s.pending = node;
+            return true;
+        }
+        s.backup(node, value, false);
     }
+    return false;
+}
 
-    auto root = std::make_unique<Node>();
-    root->state = state;
-    root->playerToMove = rootPlayer;
-    root->unexpandedMoves = moves;
-    shuffleMoves(root->unexpandedMoves, rng);
+void MCTSSearch::provideValue(float value) {
+    Impl& s = *impl;
+    if (s.pending < 0) return;
+    s.backup(s.pending, nnueLeafValue(value), false);
+    s.pending = -1;
+}
 
-    for (int iter = 0; iter < cfg.iterations; ++iter) {
-        Node* node = selectNode(root.get(), rootPlayer, cfg);
+void MCTSSearch::runParallel(RNG& rng, int threads) {
+    Impl& s = *impl;
+    if (s.hasFixedResult || s.pending >= 0) return;
+    s.prepareRoot(rng);
+    const int todo = s.cfg.iterations - s.iter;
+    if (todo <= 0) return;
+
+    // a arena não pode crescer com as threads a correr: no máx. um
+    // intervalo de filhos (UCT) ou um nó (IS) por iteração
+    if (s.cfg.informationSet) s.isTree.reserve(s.isTree.size() + todo + 1);
+    else s.tree.reserve(s.tree.size() + 4 * todo + 4);
+
+    // cada thread junta até cfg.leafBatch folhas (a perda virtual afasta
+    // as descidas seguintes das que estão à espera) e avalia-as num lote
+    const int batch = std::max(1, s.cfg.leafBatch);
+    std::atomic<int> next{0};
+    auto worker = [&s, &next, todo, batch](uint64_t seed) {
+        RNG trng(seed);
+        std::vector<GameState> leaves(batch);
+        std::vector<int> nodes(batch);
+        std::vector<int> players(batch, s.rootPlayer);
+        std::vector<float> values(batch);
+        for (;;) {
+            int n = 0;
+            int k = 0;
+            for (; k < batch && next.fetch_add(1, std::memory_order_relaxed) < todo; ++k) {
+                float value = 0.0f;
+                int node = 0;
+                if (!s.descend(trng, true, leaves[n], node, value)) {
+                    s.backup(node, value, true);
+                    continue;
+                }
+                nodes[n++] = node;
+            }
+            if (n > 0) {
+                cachedEvaluateBatch(*s.cfg.weights, leaves.data(), players.data(), n,
+                                    s.cfg.perfectInfo, values.data());
+                for (int i = 0; i < n; ++i) s.backup(nodes[i], nnueLeafValue(values[i]), true);
+            }
+            if (k < batch) break;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (int i = 1; i < threads; ++i) pool.emplace_back(worker, rng.nextU64());
+    worker(rng.nextU64());
+    for (auto& th : pool) th.join();
+    s.iter = s.cfg.iterations;
+}
 
-        if (!node->state.finished) {
-            node = expandNode(node, rootPlayer, rng);
+bool MCTSSearch::advance(int cardId) {
+    Impl& s = *impl;
+    if (!s.treeValid) return false;
+    s.pending = -1;
+
+    if (s.cfg.informationSet) {
+        const ISTree& t = s.isTree;
+        int next = -1;
+        for (int c = t.nodes[s.treeRoot].firstChild.load(std::memory_order_relaxed); c >= 0;
+             c = t.nodes[c].nextSibling.load(std::memory_order_relaxed))
+            if (t.nodes[c].card == cardId) { next = c; break; }
+        s.treeRoot = next;
+    } else {
+        const Tree& t = s.tree;
+        const Node& n = t.nodes[s.treeRoot];
+        const int idx = s.rootState.handIndexOf(n.playerToMove, cardId);
+        const int first = n.firstChild.load(std::memory_order_relaxed);
+        const int ne = n.numExpanded.load(std::memory_order_relaxed);
+        int next = -1;
+        for (int c = first; idx >= 0 && first >= 0 && c < first + ne; ++c)
+            if (t.nodes[c].ready.load(std::memory_order_relaxed) && t.nodes[c].move == idx) { next = c; break; }
+        if (next >= 0) applyMoveDeterministic(s.rootState, n.playerToMove, idx);
+        s.treeRoot = next;
+    }
+
+    s.treeValid = s.treeRoot >= 0;
+    if (!s.treeValid) {
+        s.tree = Tree{};
+        s.isTree = ISTree{};
+    }
+    return s.treeValid;
+}
+
+int MCTSSearch::reroot(const GameState& state, int rootPlayer, const MCTSConfig& cfg) {
+    Impl& s = *impl;
+    const bool sameMode = cfg.informationSet == s.cfg.informationSet;
+    bool reuse = s.treeValid && sameMode && cfg.reuseTree && rootPlayer == s.rootPlayer;
+    if (reuse && !cfg.informationSet) {
+        // o caminho jogado na árvore tem de dar a mesma posição: compras
+        // diferentes (p.ex. o monte do estado real não é o suposto) partem-no
+        const GameState& t = s.rootState;
+        reuse = t.hash == state.hash && t.hands[0] == state.hands[0] &&
+                t.hands[1] == state.hands[1] && t.deckCount == state.deckCount &&
+                s.tree.nodes[s.treeRoot].playerToMove == rootPlayer;
+    }
+
+    s.cfg = cfg;
+    if (!reuse) {
+        s.start(state, rootPlayer);
+        return 0;
+    }
+
+    s.rootState = state;
+    s.iter = 0;
+    s.pending = -1;
+    s.shuffleRoot = false;
+    if (s.setFixedResult(state)) {
+        s.tree = Tree{};
+        s.isTree = ISTree{};
+        s.treeValid = false;
+        return 0;
+    }
+
+    const int reserve = s.expectedNodes();
+    if (cfg.informationSet) s.isTree = compactSubtree(s.isTree, s.treeRoot, reserve);
+    else s.tree = compactSubtree(s.tree, s.treeRoot, reserve);
+    s.treeRoot = 0;
+    return cfg.informationSet ? s.isTree.stats[0].n() : s.tree.stats[0].n();
+}
+
+int MCTSSearch::rootPlayer() const {
+    return impl->rootPlayer;
+}
+
+bool MCTSSearch::solved() const {
+    return impl->hasFixedResult;
+}
+
+void MCTSSearch::rootChildStats(int visits[4], float values[4]) const {
+    const Impl& s = *impl;
+    for (int i = 0; i < 4; ++i) {
+        visits[i] = 0;
+        values[i] = 0.0f;
+    }
+    if (s.hasFixedResult) return;
+
+    if (s.cfg.informationSet) {
+        const ISTree& t = s.isTree;
+        for (int c = t.nodes[0].firstChild.load(std::memory_order_relaxed); c >= 0;
+             c = t.nodes[c].nextSibling.load(std::memory_order_relaxed)) {
+            const int idx = s.rootState.handIndexOf(s.rootPlayer, t.nodes[c].card);
+            if (idx < 0 || idx >= 4) continue;
+            visits[idx] += t.stats[c].n();
+            values[idx] += t.stats[c].w();
         }
+        return;
+    }
 
-        float value = rollout(node->state, rootPlayer, rng, cfg);
-        backpropagate(node, value);
+    const Tree& t = s.tree;
+    const int first = t.nodes[0].firstChild.load(std::memory_order_relaxed);
+    const int ne = t.nodes[0].numExpanded.load(std::memory_order_relaxed);
+    for (int c = first; c >= 0 && c < first + ne; ++c) {
+        if (!t.nodes[c].ready.load(std::memory_order_relaxed)) continue;
+        visits[t.nodes[c].move] += t.stats[c].n();
+        values[t.nodes[c].move] += t.stats[c].w();
     }
+}
 
-    Node* bestChild = nullptr;
-    int bestVisits = -1;
-    float bestEval = -std::numeric_limits<float>::infinity();
+MCTSResult MCTSSearch::result() const {
+    const Impl& s = *impl;
+    if (s.hasFixedResult) return s.fixedResult;
 
-    for (auto& edge : root->children) {
-        Node* child = edge.node.get();
-        if (child->visits > bestVisits) {
-            bestVisits = child->visits;
-            bestChild = child;
+    MCTSResult result;
+    if (s.cfg.informationSet) {
+        const ISTree& t = s.isTree;
+        int best = -1;
+        for (int c = t.nodes[0].firstChild.load(std::memory_order_relaxed); c >= 0;
+             c = t.nodes[c].nextSibling.load(std::memory_order_relaxed))
+            if (best < 0 || t.stats[c].n() > t.stats[best].n()) best = c;
+
+        if (best >= 0) {
+            const NodeStats& bs = t.stats[best];
+            result.chosenMoveIndex = s.rootState.handIndexOf(s.rootPlayer, t.nodes[best].card);
+            result.eval = bs.w() / static_cast<float>(std::max(1, bs.n()));
+            result.visits = bs.n();
+        } else {
+            result.chosenMoveIndex = s.rootState.getLegalMoves(s.rootPlayer).front();
         }
-        float mean = (child->visits > 0) ? (child->totalValue / child->visits) : 0.0f;
-        if (mean > bestEval) {
-            bestEval = mean;
+        return result;
+    }
+
+    const Tree& t = s.tree;
+    const Node& root = t.nodes[0];
+    const int first = root.firstChild.load(std::memory_order_relaxed);
+    const int ne = root.numExpanded.load(std::memory_order_relaxed);
+    int bestChild = -1;
+    int bestVisits = -1;
+    for (int c = first; c >= 0 && c < first + ne; ++c) {
+        if (!t.nodes[c].ready.load(std::memory_order_relaxed)) continue;
+        if (t.stats[c].n() > bestVisits) {
+            bestVisits = t.stats[c].n();
+            bestChild = c;
         }
     }
 
-    if (bestChild) {
-        result.chosenMoveIndex = bestChild->moveFromParent;
-        result.eval = (bestChild->visits > 0)
-                        ? (bestChild->totalValue / bestChild->visits)
+    if (bestChild >= 0) {
+        const NodeStats& bs = t.stats[bestChild];
+        result.chosenMoveIndex = t.nodes[bestChild].move;
+        result.eval = (bs.n() > 0)
+                        ? (bs.w() / bs.n())
                         : 0.0f;
-        result.visits = bestChild->visits;
+        result.visits = bs.n();
     } else {
-        result.chosenMoveIndex = moves.front();
+        result.chosenMoveIndex = s.rootState.getLegalMoves(s.rootPlayer).front();
         result.eval = 0.0f;
         result.visits = 0;
     }
+    return result;
+}
+
+MCTSResult searchBestMoveMCTS(MCTSSearch& search, RNG& rng, const MCTSConfig& cfg) {
+    if (cfg.threads > 1 || cfg.leafBatch > 1) {
+        search.runParallel(rng, std::max(1, cfg.threads));
+        return search.result();
+    }
+    GameState leaf;
+    while (search.run(rng, leaf)) {
+        search.provideValue(cachedEvaluate(*cfg.weights, leaf, search.rootPlayer(), cfg.perfectInfo));
+    }
+    return search.result();
+}
+
+namespace {
+
+// Root-parallel: cfg.rootTrees árvores sem nada partilhado, juntadas pelas
+// visitas dos filhos da raiz (mesmo índice na mão = mesma carta, já que
+// a determinização não mexe na mão do jogador root)
+MCTSResult searchRootParallel(const GameState& state,
+                              int rootPlayer,
+                              RNG& rng,
+                              const MCTSConfig& cfg)
+{
+    const int n = cfg.rootTrees;
+    MCTSConfig tc = cfg;
+    tc.rootTrees = 1;
+    tc.reuseTree = false;
+    tc.iterations = std::max(1, (cfg.iterations + n - 1) / n);
+
+    // sem árvore (sem jogadas / solver exato) a resposta é a mesma para todas
+    std::vector<std::unique_ptr<MCTSSearch>> trees(n);
+    trees[0] = std::make_unique<MCTSSearch>(state, rootPlayer, tc);
+    if (trees[0]->solved()) return trees[0]->result();
+
+    // UCT com informação parcial: cada árvore numa determinização própria
+    const bool determinize = !cfg.perfectInfo && !cfg.informationSet;
+    std::vector<uint64_t> seeds(n);
+    for (auto& sd : seeds) sd = rng.nextU64();
+
+    auto worker = [&](int i) {
+        RNG trng(seeds[i]);
+        if (determinize) {
+            GameState world = state;
+            world.randomizeHiddenInfo(rootPlayer, trng);
+            trees[i] = std::make_unique<MCTSSearch>(world, rootPlayer, tc);
+        } else if (!trees[i]) {
+            trees[i] = std::make_unique<MCTSSearch>(state, rootPlayer, tc);
+        }
+        searchBestMoveMCTS(*trees[i], trng, tc);
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(n - 1);
+    for (int i = 1; i < n; ++i) pool.emplace_back(worker, i);
+    worker(0);
+    for (auto& th : pool) th.join();
+
+    int visits[4] = {0, 0, 0, 0};
+    float values[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (const auto& t : trees) {
+        int v[4];
+        float w[4];
+        t->rootChildStats(v, w);
+        for (int m = 0; m < 4; ++m) {
+            visits[m] += v[m];
+            values[m] += w[m];
+        }
+    }
 
+    MCTSResult result;
+    for (int m = 0; m < 4; ++m) {
+        if (visits[m] > result.visits) {
+            result.visits = visits[m];
+            result.chosenMoveIndex = m;
+        }
+    }
+    if (result.chosenMoveIndex < 0) {
+        result.chosenMoveIndex = state.getLegalMoves(rootPlayer).front();
+        return result;
+    }
+    result.eval = values[result.chosenMoveIndex] / static_cast<float>(result.visits);
     return result;
 }
+
+} // namespace
+
+MCTSResult searchBestMoveMCTS(const GameState& state,
+                              int rootPlayer,
+                              RNG& rng,
+                              const MCTSConfig& cfg)
+{
+    if (cfg.rootTrees > 1) return searchRootParallel(state, rootPlayer, rng, cfg);
+    MCTSSearch search(state, rootPlayer, cfg);
+    return searchBestMoveMCTS(search, rng, cfg);
+}
@@ -3,6 +3,7 @@
 #include "gamestate.h"
 #include "rand.h"
 #include "eval_nnue.h"
+#include <memory>
 #include <optional>
 
 struct MCTSConfig {
@@ -12,6 +13,28 @@ struct MCTSConfig {
     const NNUEWeights* weights = nullptr;
     bool useNNUE = false;
     bool perfectInfo = false;
+    // SO-ISMCTS: uma árvore por conjunto de informação do root, com nova
+    // determinização das cartas escondidas em cada iteração
+    bool informationSet = false;
+    // Reaproveitar a árvore entre lances (MCTSSearch::advance/reroot)
+    bool reuseTree = true;
+    // Threads na mesma árvore em searchBestMoveMCTS (tree-parallel com
+    // perda virtual); 1 = pesquisa sequencial
+    int threads = 1;
+    // Root-parallel: searchBestMoveMCTS corre rootTrees árvores
+    // independentes (cada uma numa thread, com outra seed e, sem
+    // perfectInfo, outra determinização das cartas escondidas) que
+    // dividem as iterações; no fim somam-se as visitas e os valores dos
+    // filhos da raiz e joga-se o mais visitado
+    int rootTrees = 1;
+    // Rede de valor: as folhas vão diretamente para a NNUE (convertida para
+    // a escala [-1, 1] dos resultados) em vez de rollouts aleatórios até ao
+    // fim; rolloutLimit passa a ser o nº de jogadas aleatórias antes da
+    // avaliação (0 = nenhuma). Precisa de useNNUE e weights.
+    bool valueNet = false;
+    // Folhas juntadas (com perda virtual) por cada thread antes de as
+    // avaliar num só lote da NNUE; > 1 usa runParallel mesmo com 1 thread
+    int leafBatch = 1;
 };
 
 struct MCTSResult {
@@ -26,3 +49,60 @@ MCTSResult searchBestMoveMCTS(const GameState& state,
                               int rootPlayer,
                               RNG& rng,
                               const MCTSConfig& cfg);
+
+// Pesquisa MCTS retomável: em vez de chamar a NNUE no fim de cada rollout,
+// run() pára e devolve a posição a avaliar (ponto de vista de rootPlayer);
+// o chamador avalia-a quando quiser (p.ex. num lote com folhas de outros
+// jogos) e continua com provideValue(). searchBestMoveMCTS é o ciclo
+// simples com nnueEvaluate.
+class MCTSSearch {
+public:
+    MCTSSearch(const GameState& state, int rootPlayer, const MCTSConfig& cfg);
+    ~MCTSSearch();
+
+    MCTSSearch(const MCTSSearch&) = delete;
+    MCTSSearch& operator=(const MCTSSearch&) = delete;
+
+    // Corre iterações até uma precisar da NNUE (true, posição em `leaf`)
+    // ou até acabarem (false; ver result())
+    bool run(RNG& rng, GameState& leaf);
+    // Avaliação NNUE (nnueEvaluate do ponto de vista de rootPlayer()) da
+    // última folha devolvida por run(); é convertida para a escala da árvore
+    void provideValue(float value);
+
+    // Corre as iterações que faltam com `threads` threads na mesma árvore
+    // (perda virtual na descida, expansão sem locks), avaliando as folhas
+    // com a NNUE em lotes de até cfg.leafBatch por thread. Não se mistura
+    // com run() a meio.
+    void runParallel(RNG& rng, int threads);
+
+    int rootPlayer() const;
+    MCTSResult result() const;
+
+    // A raiz não precisa de árvore (sem jogadas ou fim de jogo resolvido
+    // pelo solver exato); result() já é final
+    bool solved() const;
+    // Visitas e soma dos valores (perspetiva de rootPlayer) de cada filho
+    // da raiz, por índice na mão; índices sem filho ficam a 0
+    void rootChildStats(int visits[4], float values[4]) const;
+
+    // Reaproveitamento da árvore entre lances: advance() desce a raiz pela
+    // carta jogada no jogo real (cardId), de quem quer que seja a vez;
+    // devolve false se a jogada nunca foi explorada (a árvore é largada).
+    // reroot() prepara uma nova pesquisa de cfg.iterations iterações em
+    // `state`, mantendo a subárvore a que se chegou se ainda corresponder
+    // a `state` (mesmo jogador root e, no UCT, o mesmo hash: compras
+    // diferentes das previstas partem o caminho); senão começa do zero.
+    // Devolve as visitas herdadas pela nova raiz.
+    bool advance(int cardId);
+    int reroot(const GameState& state, int rootPlayer, const MCTSConfig& cfg);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+// Corre até ao fim uma pesquisa já criada (p.ex. depois de reroot),
+// avaliando as folhas com a NNUE como a versão acima; com cfg.threads > 1
+// ou cfg.leafBatch > 1 usa runParallel
+MCTSResult searchBestMoveMCTS(MCTSSearch& search, RNG& rng, const MCTSConfig& cfg);
@@ -1,55 +1,129 @@
 #include "selfplay_mcts.h"
 #include "eval_nnue.h"
+#include "eval_server.h"
+#include "eval_cache.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <memory>
 
-std::vector<SelfPlaySampleMCTS> playSelfPlayGameMCTS(const MCTSConfig& cfg,
-                                                     RNG& rng)
-{
+namespace {
+
+struct SelfPlayGame {
     GameState st;
-    st.newGame(rng);
+    std::vector<SelfPlaySampleMCTS> samples;
+    // árvore de cada jogador, reaproveitada entre lances (cfg.reuseTree)
+    std::unique_ptr<MCTSSearch> trees[2];
+    MCTSSearch* search = nullptr; // pesquisa do lance atual
+    bool done = false;
+};
 
-    std::vector<SelfPlaySampleMCTS> result;
-    result.reserve(200);
+void finishGame(SelfPlayGame& g, const MCTSConfig& cfg) {
+    g.done = true;
+    g.search = nullptr;
+    for (auto& t : g.trees) t.reset();
 
-    while (!st.finished) {
-        int p = st.currentPlayer;
+    int diff = g.st.score[0] - g.st.score[1];
+    for (auto& s : g.samples) {
+        s.outcome = static_cast<float>(diff);
+    }
 
-        SelfPlaySampleMCTS sample;
-        sample.features = extractFeatures(st, p, cfg.perfectInfo);
-        sample.outcome = 0.0f;
+    std::cout << "Self-play MCTS terminou. "
+              << "Score0=" << g.st.score[0]
+              << " Score1=" << g.st.score[1]
+              << " Diff="   << diff
+              << " perfectInfo=" << (cfg.perfectInfo ? 1 : 0)
+              << "\n";
+}
 
-        MCTSResult sr = searchBestMoveMCTS(st, p, rng, cfg);
-        int moveIdx = sr.chosenMoveIndex;
-        if (moveIdx < 0) {
-            st.finished = true;
-            break;
+// Avança o jogo até a pesquisa pedir uma folha (true) ou o jogo acabar
+bool advanceGame(SelfPlayGame& g, const MCTSConfig& cfg, RNG& rng, GameState& leaf) {
+    while (!g.done) {
+        if (!g.search) {
+            if (g.st.finished) {
+                finishGame(g, cfg);
+                return false;
+            }
+            SelfPlaySampleMCTS sample;
+            sample.features = extractFeatures(g.st, g.st.currentPlayer, cfg.perfectInfo);
+            sample.outcome = 0.0f;
+            g.samples.push_back(std::move(sample));
+            const int p = g.st.currentPlayer;
+            if (g.trees[p]) g.trees[p]->reroot(g.st, p, cfg);
+            else g.trees[p] = std::make_unique<MCTSSearch>(g.st, p, cfg);
+            g.search = g.trees[p].get();
         }
 
-        if (!st.playCard(p, moveIdx)) {
-            st.finished = true;
-            break;
-        }
-        st.maybeCloseTrick(rng);
+        if (g.search->run(rng, leaf)) return true;
 
-        result.push_back(std::move(sample));
+        // pesquisa acabou: joga o lance
+        const int p = g.search->rootPlayer();
+        const int moveIdx = g.search->result().chosenMoveIndex;
+        const int card = g.st.handCardId(p, moveIdx);
+        g.search = nullptr;
+        if (!cfg.reuseTree) g.trees[p].reset();
+        if (moveIdx < 0 || !g.st.playCard(p, moveIdx)) {
+            g.samples.pop_back();
+            g.st.finished = true;
+            finishGame(g, cfg);
+            return false;
+        }
+        g.st.maybeCloseTrick(rng);
+        for (auto& t : g.trees)
+            if (t) t->advance(card);
     }
+    return false;
+}
 
-    int diff = st.score[0] - st.score[1];
-    for (auto& s : result) {
-        s.outcome = static_cast<float>(diff);
+} // namespace
+
+std::vector<std::vector<SelfPlaySampleMCTS>> playSelfPlayGamesMCTS(const MCTSConfig& cfg,
+                                                                   int games,
+                                                                   RNG& rng,
+                                                                   NNUEEvalServer* server)
+{
+    std::vector<SelfPlayGame> g(std::max(1, games));
+    for (auto& game : g) {
+        game.st.newGame(rng);
+        game.samples.reserve(200);
     }
 
-    std::cout << "Self-play MCTS terminou. "
-              << "Score0=" << st.score[0]
-              << " Score1=" << st.score[1]
-              << " Diff="   << diff
-              << " perfectInfo=" << (cfg.perfectInfo ? 1 : 0)
-              << "\n";
+    std::vector<GameState> leaves(g.size());
+    std::vector<int> players(g.size());
+    std::vector<float> values(g.size());
+    std::vector<int> owner(g.size());
+
+    for (;;) {
+        int n = 0;
+        for (int i = 0; i < (int)g.size(); ++i) {
+            if (advanceGame(g[i], cfg, rng, leaves[n])) {
+                players[n] = g[i].search->rootPlayer();
+                owner[n] = i;
+                ++n;
+            }
+        }
+        if (n == 0) break;
+
+        if (server)
+            server->evaluateMany(leaves.data(), players.data(), n, values.data());
+        else
+            cachedEvaluateBatch(*cfg.weights, leaves.data(), players.data(), n, cfg.perfectInfo, values.data());
 
+        for (int k = 0; k < n; ++k) g[owner[k]].search->provideValue(values[k]);
+    }
+
+    std::vector<std::vector<SelfPlaySampleMCTS>> result;
+    result.reserve(g.size());
+    for (auto& game : g) result.push_back(std::move(game.samples));
     return result;
 }
 
+std::vector<SelfPlaySampleMCTS> playSelfPlayGameMCTS(const MCTSConfig& cfg,
+                                                     RNG& rng)
+{
+    return std::move(playSelfPlayGamesMCTS(cfg, 1, rng, nullptr).front());
+}
+
 bool saveSamplesMCTS(const std::vector<SelfPlaySampleMCTS>& samples,
                      const std::string& path)
 {
@@ -9,8 +9,19 @@ struct SelfPlaySampleMCTS {
     float outcome;
 };
 
+class NNUEEvalServer; // eval_server.h
+
 std::vector<SelfPlaySampleMCTS> playSelfPlayGameMCTS(const MCTSConfig& cfg,
                                                      RNG& rng);
 
+// Joga `games` partidas intercaladas nesta thread: cada uma é uma
+// MCTSSearch retomável e, a cada ronda, as folhas NNUE de todos os jogos
+// são avaliadas juntas (no servidor, se houver, senão com
+// nnueEvaluateBatch). Devolve as amostras de cada jogo.
+std::vector<std::vector<SelfPlaySampleMCTS>> playSelfPlayGamesMCTS(const MCTSConfig& cfg,
+                                                                   int games,
+                                                                   RNG& rng,
+                                                                   NNUEEvalServer* server);
+
 bool saveSamplesMCTS(const std::vector<SelfPlaySampleMCTS>& samples,
                      const std::string& path);
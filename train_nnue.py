@@ -1,4 +1,6 @@
+import os
 import struct
+import zlib
 import argparse
 import torch
 import torch.nn as nn
@@ -97,10 +99,70 @@ class NNUEModel(nn.Module):
         x = self.fc3(x)
         return x
 
+# -------------------------------------------------
+# Formato v2 do motor C++ (saveWeights / loadWeights, ver eval_nnue.h):
+#   cabeçalho 64 bytes: "B4NN", u32 versão, u32 input, u32 h1, u32 h2,
+#     u32 nº secções, u32 CRC-32 do resto do ficheiro, u32 0, u64 tamanho
+#   descritores de 32 bytes: u32 id, u32 tipo (0=float32), u32 linhas,
+#     u32 colunas, u64 offset, u64 bytes
+#   secções float32 alinhadas a 64 bytes
+# -------------------------------------------------
+NNUE_MAGIC = b"B4NN"
+NNUE_FILE_VERSION = 2
+SEC_W1, SEC_W1T, SEC_B1, SEC_W2, SEC_W2T, SEC_B2, SEC_W3, SEC_B3 = range(1, 9)
+
+def _align64(x):
+    return (x + 63) & ~63
+
+def read_weights_v2(raw):
+    magic, version, inSz, h1, h2, count, checksum, _, size = struct.unpack_from("<4s7IQ", raw, 0)
+    if version != NNUE_FILE_VERSION:
+        raise ValueError(f"versão de pesos {version} não suportada")
+    if size != len(raw) or zlib.crc32(raw[64:]) != checksum:
+        raise ValueError("ficheiro de pesos truncado ou checksum errado")
+    secs = {}
+    for k in range(count):
+        sid, typ, rows, cols, off, nbytes = struct.unpack_from("<4I2Q", raw, 64 + 32 * k)
+        secs[sid] = np.frombuffer(raw, dtype=np.float32, count=rows * cols, offset=off).reshape(rows, cols)
+    return inSz, h1, h2, secs
+
+def write_weights_v2(path, inSz, h1, h2, w1, b1, w2, b2, w3, b3):
+    secs = [
+        (SEC_W1, w1.reshape(h1, inSz)),
+        (SEC_W1T, w1.reshape(h1, inSz).T),
+        (SEC_B1, b1.reshape(1, h1)),
+        (SEC_W2, w2.reshape(h2, h1)),
+        (SEC_W2T, w2.reshape(h2, h1).T),
+        (SEC_B2, b2.reshape(1, h2)),
+        (SEC_W3, w3.reshape(1, h2)),
+        (SEC_B3, b3.reshape(1, 1)),
+    ]
+    off = _align64(64 + 32 * len(secs))
+    desc = b""
+    body = bytearray(off - 64 - 32 * len(secs))
+    for sid, a in secs:
+        data = np.ascontiguousarray(a, dtype=np.float32).tobytes(order="C")
+        desc += struct.pack("<4I2Q", sid, 0, a.shape[0], a.shape[1], off, len(data))
+        body += data
+        pad = _align64(off + len(data)) - (off + len(data))
+        body += bytes(pad)
+        off += len(data) + pad
+    rest = desc + bytes(body)
+    header = struct.pack("<4s7IQ", NNUE_MAGIC, NNUE_FILE_VERSION, inSz, h1, h2,
+                         len(secs), zlib.crc32(rest), 0, 64 + len(rest))
+    header += bytes(64 - len(header))
+    # ficheiro temporário + os.replace: um motor que tenha a rede mapeada
+    # continua a ver a antiga em vez de um ficheiro a meio
+    tmp = path + ".tmp"
+    with open(tmp, "wb") as f:
+        f.write(header)
+        f.write(rest)
+    os.replace(tmp, path)
+
 # -------------------------------------------------
 # Carregar pesos no formato binário do motor C++
 #
-# Formato C++ (saveWeights):
+# Formato v2 (acima) ou o antigo sem cabeçalho:
 #   int inputSize
 #   int hiddenSize
 #   w1[hiddenSize*inputSize] float32
@@ -121,6 +183,19 @@ def load_weights_into_model(model, path):
     with open(path, "rb") as f:
         raw = f.read()
 
+    if raw[:4] == NNUE_MAGIC:
+        inSz, h1, h2, secs = read_weights_v2(raw)
+        if inSz != INPUT_SIZE or h1 != H1 or h2 != H2:
+            raise ValueError(f"Dimensões NNUE incompatíveis: ficheiro {inSz}->{h1}->{h2}, esperado {INPUT_SIZE}->{H1}->{H2}")
+        with torch.no_grad():
+            model.fc1.weight.copy_(torch.tensor(secs[SEC_W1].copy()))
+            model.fc1.bias.copy_(torch.tensor(secs[SEC_B1].reshape(-1).copy()))
+            model.fc2.weight.copy_(torch.tensor(secs[SEC_W2].copy()))
+            model.fc2.bias.copy_(torch.tensor(secs[SEC_B2].reshape(-1).copy()))
+            model.fc3.weight.copy_(torch.tensor(secs[SEC_W3].copy()))
+            model.fc3.bias.copy_(torch.tensor(secs[SEC_B3].reshape(-1).copy()))
+        return
+
     off = 0
 
     def read_i32():
@@ -190,16 +265,7 @@ def save_model_weights(model, path):
     fc3_w = model.fc3.weight.detach().cpu().numpy()  # (1,H2)
     fc3_b = model.fc3.bias.detach().cpu().numpy()    # (1,)
 
-    with open(path, "wb") as f:
-        f.write(struct.pack("<i", INPUT_SIZE))
-        f.write(struct.pack("<i", H1))
-        f.write(struct.pack("<i", H2))
-        f.write(fc1_w.astype("float32").tobytes(order="C"))
-        f.write(fc1_b.astype("float32").tobytes(order="C"))
-        f.write(fc2_w.astype("float32").tobytes(order="C"))
-        f.write(fc2_b.astype("float32").tobytes(order="C"))
-        f.write(fc3_w.reshape(-1).astype("float32").tobytes(order="C"))
-        f.write(fc3_b.astype("float32").tobytes(order="C"))
+    write_weights_v2(path, INPUT_SIZE, H1, H2, fc1_w, fc1_b, fc2_w, fc2_b, fc3_w, fc3_b)
 
 # -------------------------------------------------
 # Função de treino